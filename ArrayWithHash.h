@@ -10,6 +10,9 @@
 #include <string.h>
 #include <algorithm>
 #include <memory>
+#ifndef AWH_NO_CPP11
+#include <random>   //used only in SampleRandom
+#endif
 #ifdef AWH_TESTING
 #include <set>   //used only in AssertCorrectness
 #endif
@@ -20,6 +23,7 @@
 
 //compiler must be able to find these companion headers in its include path
 #include "ArrayWithHash_Utils.h"
+#include "ArrayWithHash_Simd.h"
 #ifndef AWH_NO_CPP11
 #include "ArrayWithHash_Traits.h"
 #endif
@@ -28,15 +32,23 @@
 namespace AWH_NAMESPACE {
 
 //minimal allowed fill ratio of array part on automatic reallocation
-static const double ARRAY_MIN_FILL = 0.45;
+static AWH_CONSTEXPR double ARRAY_MIN_FILL = 0.45;
 //minimal allowed fill ratiu of hash table part on automatic reallocation
-static const double HASH_MIN_FILL = 0.30;
+static AWH_CONSTEXPR double HASH_MIN_FILL = 0.30;
 //maximal allowed fill ratio of hash table part ever (next insert -> reallocation)
-static const double HASH_MAX_FILL = 0.75;
+static AWH_CONSTEXPR double HASH_MAX_FILL = 0.75;
 //minimal size of non-empty array part
-static const size_t ARRAY_MIN_SIZE = 8;
+static AWH_CONSTEXPR size_t ARRAY_MIN_SIZE = 8;
 //minimal size of non-empty hash part
-static const size_t HASH_MIN_SIZE = 8;
+static AWH_CONSTEXPR size_t HASH_MIN_SIZE = 8;
+//number of elements looked ahead when prefetching in bulk operations
+static AWH_CONSTEXPR size_t PREFETCH_DISTANCE = 16;
+//number of array cells compared at once with memcmp when comparing containers
+static AWH_CONSTEXPR size_t COMPARE_BLOCK = 16;
+//minimal number of keys sorted with radix sort (std::sort is used for less keys)
+static AWH_CONSTEXPR size_t RADIX_SORT_MIN = 64;
+//number of random cells tried by SampleRandom before it falls back to scanning
+static AWH_CONSTEXPR size_t SAMPLE_ATTEMPTS = 32;
 //fast check for reaching HASH_MAX_FILL ratio (without float arithmetics)
 template<class Size> static AWH_INLINE bool IsHashFull(Size cfill, Size sz) {
 	return cfill >= ((sz >> 2) * 3);
@@ -80,6 +92,9 @@ private:
 	Size hashCount;
 	//hash part: number of cells used (including those tagged as REMOVED)
 	Size hashFill;
+	//all keys in range [0, border) are present (i.e. it is lower bound for Length)
+	//note: it is advanced lazily in Length
+	Size border;
 	//array part: pointer to buffer
 	Value *arrayValues;
 	//hash part: pointer to buffer with values only
@@ -100,13 +115,16 @@ private:
 		free(buffer);
 	}
 
+	//moves values when memcpy cannot be used (swap is used if ValueTraits::RELOCATE_WITH_SWAP is set)
+	typedef ValueMover<Value, RelocateWithSwap<ValueTraits>::value> Mover;
+
 	//relocate single value from alive src to dead dst
 	//after relocation: src is dead, dst is alive
 	static AWH_INLINE void RelocateOne(Value &dst, Value &src) {
 		if (ValueTraits::RELOCATE_WITH_MEMCPY)
 			memcpy(&dst, &src, sizeof(Value));
 		else {
-			new (&dst) Value(AWH_MOVE(src));
+			Mover::Construct(&dst, src);
 			src.~Value();
 		}
 	}
@@ -116,11 +134,32 @@ private:
 			memcpy(dst, src, size_t(cnt) * sizeof(Value));
 		else {
 			for (Size i = 0; i < cnt; i++) {
-				new (&dst[i]) Value(AWH_MOVE(src[i]));
+				Mover::Construct(&dst[i], src[i]);
 				src[i].~Value();
 			}
 		}
 	}
+	//construct EMPTY values in raw buffer
+	//trivially copyable value with all bytes equal is replicated with memset
+	//note: buffer may be alive too if values are trivially copyable
+	static void ConstructEmptyValues(Value *dst, Size cnt) {
+		if (IsTriviallyCopyable<Value>::value) {
+			const Value &empty = ValueTraits::GetEmpty();
+			if (IsByteUniform(empty)) {
+				memset((void*)dst, *(const unsigned char*)&empty, size_t(cnt) * sizeof(Value));
+				return;
+			}
+		}
+		for (Size i = 0; i < cnt; i++)
+			new (&dst[i]) Value(ValueTraits::GetEmpty());
+	}
+	//fill buffer of keys with EMPTY_KEY (keys are integers, so memset is allowed)
+	static void FillEmptyKeys(Key *dst, Size cnt) {
+		if (IsByteUniform(Key(EMPTY_KEY)))
+			memset(dst, (unsigned char)EMPTY_KEY, size_t(cnt) * sizeof(Key));
+		else
+			std::fill_n(dst, cnt, Key(EMPTY_KEY));
+	}
 
 	//checks whether given key belongs to the array part
 	AWH_INLINE bool InArray(Key key) const {
@@ -154,31 +193,56 @@ private:
 		return cell;
 	}
 
-	//resize array and hash parts due to hash table fill ratio maximized
-	//newKey parameter is the new key to be inserted right after resizing
-	//the new sizes are chosen so that both the old keys and the new one fit
-	AWH_NOINLINE void AdaptSizes(Key newKey) {
-		static const int BITS = sizeof(Size) * 8;
-		//logHisto[t] = number of keys in range [2^(t-1); 2^t - 1]
-		Size logHisto[BITS + 1] = {0};
-		Size logArraySize = log2up(arraySize);
+	//returns bitmask of valid cells (neither EMPTY nor REMOVED) among SIMD_BLOCK cells of hash part
+	//starting from the given one (the best SIMD kernel for current CPU is used)
+	AWH_INLINE uint32_t HashValidMask(Size start) const {
+		return ValidKeysMask(hashKeys + start);
+	}
+	//same as HashValidMask, but for any buffer of keys (e.g. old hash table during reallocation)
+	static AWH_INLINE uint32_t ValidKeysMask(const Key *keys) {
+		typedef typename SimdWord<Key>::type Word;
+		return SimdKernels<Word>::ValidMask()((const Word*)keys, Word(EMPTY_KEY), Word(REMOVED_KEY));
+	}
 
-		//=== populate logHisto histogram with all the valid elements ===
-		logHisto[logArraySize] = arrayCount;	//elements in array part
-		logHisto[log2size(newKey)]++;			//to-be-inserted element
-		for (Size i = 0; i < hashSize; i++) {
-			//Note: only elements in hash table part are processed
+	//number of bits in Size type (and also in Key type)
+	static const int BITS = sizeof(Size) * 8;
+
+	//add given key to the histogram of key lengths (used to choose sizes of parts)
+	//logHisto[t] = number of keys in range [2^(t-1); 2^t - 1]
+	//note: all keys fitting into the current array part are counted together
+	AWH_INLINE void AddToLogHisto(Size *logHisto, Key key) const {
+		Size keyBits = log2size((Size)key);
+		logHisto[std::max(keyBits, log2up(arraySize))]++;
+	}
+	//populate histogram of key lengths with all the valid elements
+	AWH_INLINE void FillLogHisto(Size *logHisto) const {
+		logHisto[log2up(arraySize)] += arrayCount;	//elements in array part
+		//Note: only elements in hash table part are processed
+		Size blocksEnd = hashSize & ~Size(SIMD_BLOCK - 1);
+		if (blocksEnd > 0) {
+			//whole blocks are counted by SIMD kernel into its own histogram
+			typedef typename SimdWord<Key>::type Word;
+			uint64_t histo[SIMD_HISTO_SIZE] = {0};
+			SimdKernels<Word>::LogHisto()((const Word*)hashKeys, size_t(blocksEnd), Word(EMPTY_KEY), Word(REMOVED_KEY), histo);
+			for (int t = 0; t <= BITS; t++)
+				logHisto[t] += Size(histo[t]);
+		}
+		//small hash table (less than one block)
+		for (Size i = blocksEnd; i < hashSize; i++) {
 			Key key = hashKeys[i];
-			if (key == EMPTY_KEY || key == REMOVED_KEY)
-				continue;
-			//valid element: increment histogram count
-			Size keyBits = log2size((Size)key);
-			assert(keyBits >= logArraySize);
-			logHisto[keyBits]++;
+			if (key != EMPTY_KEY && key != REMOVED_KEY)
+				logHisto[log2size((Size)key)]++;
 		}
+	}
+
+	//choose new sizes of array and hash parts, given histogram of all keys
+	//totalCount is the total number of elements which must fit into the container
+	void ChooseSizes(const Size *logHisto, Size totalCount, Size &newArraySize, Size &newHashSize) const {
+		Size logArraySize = log2up(arraySize);
 
 		//=== choose appropriate size for the array part ===
-		Size newArraySize = 0, newArrayCount = 0;
+		Size newArrayCount = 0;
+		newArraySize = 0;
 		//note: array cannot be shrink, and it cannot be too small
 		Size lowerBound = std::max(arraySize, (Size)ARRAY_MIN_SIZE);
 		Size prefSum = 0;
@@ -193,7 +257,7 @@ private:
 				newArraySize = aSize;
 				newArrayCount = prefSum;
 			}
-			else if (arrayCount + hashCount + 1 < required)
+			else if (totalCount < required)
 				break;	//this size and greater are surely not viable
 		}
 		//if still no element is in the array part, then do not create it
@@ -201,15 +265,28 @@ private:
 			newArraySize = 0;
 
 		//=== choose appropriate size for the hash table part ===
-		Size newHashCount = arrayCount + hashCount - newArrayCount + 1;
+		Size newHashCount = totalCount - newArrayCount;
 		//hash table part cannot shrink, and it cannot be too small
-		Size newHashSize = std::max(hashSize, (Size)HASH_MIN_SIZE);
+		newHashSize = std::max(hashSize, (Size)HASH_MIN_SIZE);
 		//increase hash size as long as hash fill ratio does not drop too small
 		while (newHashCount >= HASH_MIN_FILL * newHashSize * 2)
 			newHashSize *= 2;
 		//if still no element is in the hash table part, then do not create it
 		if (hashSize == 0 && newHashCount == 0)
 			newHashSize = 0;
+	}
+
+	//resize array and hash parts due to hash table fill ratio maximized
+	//newKey parameter is the new key to be inserted right after resizing
+	//the new sizes are chosen so that both the old keys and the new one fit
+	AWH_NOINLINE void AdaptSizes(Key newKey) {
+		Size logHisto[BITS + 1] = {0};
+		//=== populate logHisto histogram with all the valid elements ===
+		FillLogHisto(logHisto);
+		AddToLogHisto(logHisto, newKey);	//to-be-inserted element
+
+		Size newArraySize, newHashSize;
+		ChooseSizes(logHisto, arrayCount + hashCount + 1, newArraySize, newHashSize);
 
 		//physically relocate all the data
 		Reallocate(newArraySize, newHashSize);
@@ -232,14 +309,35 @@ private:
 		}
 		//upper part of the array is still dead (i.e. raw, not constructed)
 		//we construct all these elements with EMPTY value
-		for (Value *ptr = newArrayValues + arraySize; ptr < newArrayValues + newArraySize; ptr++)
-			new (ptr) Value(ValueTraits::GetEmpty());
+		ConstructEmptyValues(newArrayValues + arraySize, newArraySize - arraySize);
 
 		//save the new array
 		arrayValues = newArrayValues;
 		arraySize = newArraySize;
 	}
 
+	//relocate valid element from the given cell during RelocateHashInPlace
+	//the cell must be already marked as EMPTY (key is passed separately)
+	template<bool RELOC_ARRAY> AWH_INLINE void RelocateCellInPlace(Key key, Size pos) {
+		Value &value = hashValues[pos];
+		if (RELOC_ARRAY && InArray(key)) {
+			//fits into expanded array part
+			//note: destination must be killed before relocation
+			arrayValues[key].~Value();
+			RelocateOne(arrayValues[key], value);
+			arrayCount++;
+		}
+		else {
+			//must be retained in the hash table part
+			//in order to find its new place, insert it as usual
+			Size cell = FindCellEmpty(key);
+			hashKeys[cell] = key;
+			//relocate element's value (only if its cell has changed)
+			if (cell != pos)
+				RelocateOne(hashValues[cell], value);
+		}
+	}
+
 	//perform a single pass over hash table in order to:
 	// 1. clean, i.e. eliminate all REMOVED entries
 	// 2. move some elements into array part (if RELOC_ARRAY is true)
@@ -262,37 +360,42 @@ private:
 		//do a full round over the hash table
 		//note: iteration is started from the first empty cell
 		//as a result, each group of non-empty elements is enumerated in order
-		Size pos = firstEmpty;
-		do {
+		Size pos = firstEmpty, left = hashSize;
+		//go cell-by-cell until position is aligned to SIMD block
+		for (; left > 0 && (pos & Size(SIMD_BLOCK - 1)); left--) {
 			Key key = hashKeys[pos];
 			//mark key as empty, even if it is valid,
 			//allowing it to be found by FindCellEmpty later
 			hashKeys[pos] = EMPTY_KEY;
-
-			if (key != EMPTY_KEY && key != REMOVED_KEY) {
-				//valid element: must be relocated
-				Value &value = hashValues[pos];
-				if (RELOC_ARRAY && InArray(key)) {
-					//fits into expanded array part
-					//note: destination must be killed before relocation
-					arrayValues[key].~Value();
-					RelocateOne(arrayValues[key], value);
-					arrayCount++;
-				}
-				else {
-					//must be retained in the hash table part
-					//in order to find its new place, insert it as usual
-					Size cell = FindCellEmpty(key);
-					hashKeys[cell] = key;
-					//relocate element's value (only if its cell has changed)
-					if (cell != pos)
-						RelocateOne(hashValues[cell], value);
-				}
-			}
-
+			if (key != EMPTY_KEY && key != REMOVED_KEY)
+				RelocateCellInPlace<RELOC_ARRAY>(key, pos);
 			//go to the next cell (cyclically)
 			pos = (pos + 1) & (hashSize - 1);
-		} while (pos != firstEmpty);
+		}
+		//go over whole blocks, visiting only valid cells
+		for (; left >= Size(SIMD_BLOCK); left -= Size(SIMD_BLOCK)) {
+			uint32_t mask = HashValidMask(pos);
+			Key keys[SIMD_BLOCK];
+			for (Size j = 0; j < Size(SIMD_BLOCK); j++) {
+				keys[j] = hashKeys[pos + j];
+				hashKeys[pos + j] = EMPTY_KEY;
+			}
+			//note: whole block is marked as empty at once
+			//it is safe since element is never moved to a cell after its current one
+			for (; mask; mask &= mask - 1) {
+				Size j = ctz(mask);
+				RelocateCellInPlace<RELOC_ARRAY>(keys[j], pos + j);
+			}
+			pos = (pos + Size(SIMD_BLOCK)) & (hashSize - 1);
+		}
+		//the rest cells (only if hash table is smaller than one block)
+		for (; left > 0; left--) {
+			Key key = hashKeys[pos];
+			hashKeys[pos] = EMPTY_KEY;
+			if (key != EMPTY_KEY && key != REMOVED_KEY)
+				RelocateCellInPlace<RELOC_ARRAY>(key, pos);
+			pos = (pos + 1) & (hashSize - 1);
+		}
 
 		//if necessary, update hash table count
 		if (RELOC_ARRAY)
@@ -301,6 +404,35 @@ private:
 		hashFill = hashCount;
 	}
 
+	//relocate valid element from the old hash table during RelocateHashToNew
+	template<bool RELOC_ARRAY> AWH_INLINE void RelocateCellToNew(Key key, Value &value) {
+		if (RELOC_ARRAY && InArray(key)) {
+			//fits into expanded array part
+			//note: destination must be killed before relocation
+			arrayValues[key].~Value();
+			RelocateOne(arrayValues[key], value);
+			arrayCount++;
+		}
+		else {
+			//must be inserted into the new hash table
+			Size cell = FindCellEmpty(key);
+			hashKeys[cell] = key;
+			RelocateOne(hashValues[cell], value);
+		}
+	}
+
+	//relocate valid element from the old hash table in a software pipeline:
+	//its destination is prefetched now, and it is actually moved PREFETCH_DISTANCE elements later
+	//window keeps indices of elements not moved yet, found is total number of elements seen
+	template<bool RELOC_ARRAY> AWH_INLINE void RelocateCellPipelined(const Key *oldKeys, Value *oldValues, Size *window, Size &found, Size idx) {
+		Prefetch(oldKeys[idx]);
+		Size &slot = window[found % Size(PREFETCH_DISTANCE)];
+		if (found >= Size(PREFETCH_DISTANCE))
+			RelocateCellToNew<RELOC_ARRAY>(oldKeys[slot], oldValues[slot]);
+		slot = idx;
+		found++;
+	}
+
 	//reallocate the hash table part, doing the following in process:
 	// 1. clean, i.e. eliminate all REMOVED entries
 	// 2. move some elements into array part (if RELOC_ARRAY is true)
@@ -312,7 +444,7 @@ private:
 		//create new buffers for the hash table
 		Key *newHashKeys = AllocateBuffer<Key>(newHashSize);
 		//note: fill keys buffer with EMPTY key
-		std::uninitialized_fill_n(newHashKeys, newHashSize, Key(EMPTY_KEY));
+		FillEmptyKeys(newHashKeys, newHashSize);
 		Value *newHashValues = AllocateBuffer<Value>(newHashSize);
 		//note: leave values buffer raw (i.e. no elements constructed)
 
@@ -324,25 +456,23 @@ private:
 
 		Size totalCount = arrayCount + hashCount;
 		//iterate over all elements in the old hash table (and relocate them)
-		for (Size i = 0; i < newHashSize; i++) {
+		//note: random accesses to the new table are overlapped (see RelocateCellPipelined)
+		Size window[PREFETCH_DISTANCE];
+		Size found = 0;
+		Size i = 0;
+		for (; i + Size(SIMD_BLOCK) <= newHashSize; i += Size(SIMD_BLOCK))
+			for (uint32_t mask = ValidKeysMask(newHashKeys + i); mask; mask &= mask - 1)
+				RelocateCellPipelined<RELOC_ARRAY>(newHashKeys, newHashValues, window, found, i + ctz(mask));
+		//small hash table (less than one block)
+		for (; i < newHashSize; i++) {
 			Key key = newHashKeys[i];
-			if (key == EMPTY_KEY || key == REMOVED_KEY)
-				continue;
-			//valid key found, must be inserted into the new hash table
-			Value &value = newHashValues[i];
-			if (RELOC_ARRAY && InArray(key)) {
-				//fits into expanded array part
-				//note: destination must be killed before relocation
-				arrayValues[key].~Value();
-				RelocateOne(arrayValues[key], value);
-				arrayCount++;
-			}
-			else {
-				//must be inserted into the new hash table
-				Size cell = FindCellEmpty(key);
-				hashKeys[cell] = key;
-				RelocateOne(hashValues[cell], value);
-			}
+			if (key != EMPTY_KEY && key != REMOVED_KEY)
+				RelocateCellPipelined<RELOC_ARRAY>(newHashKeys, newHashValues, window, found, i);
+		}
+		//finish relocation of the elements remaining in the window
+		for (Size k = (found > Size(PREFETCH_DISTANCE) ? found - Size(PREFETCH_DISTANCE) : 0); k < found; k++) {
+			Size j = window[k % Size(PREFETCH_DISTANCE)];
+			RelocateCellToNew<RELOC_ARRAY>(newHashKeys[j], newHashValues[j]);
 		}
 
 		//free the old hash table buffers
@@ -405,7 +535,8 @@ private:
 		return hashKeys[cell] == EMPTY_KEY ? NULL : &hashValues[cell];
 	}
 
-	AWH_NOINLINE Value *HashSet(Key key, Value value) {
+	//note: value is moved from the given variable (owned by caller)
+	AWH_NOINLINE Value *HashSet(Key key, Value &value) {
 		if (IsHashFull(hashFill, hashSize)) {
 			//fill ratio of hash part is at its allowed maximum
 			//reallocation may be necessary to finish the operation
@@ -413,7 +544,13 @@ private:
 			//perform the operation after reallocation
 			//note: we cannot just do HashGet here,
 			//because the element may now go into the array part
-			return Set(key, AWH_MOVE(value));
+			if (InArray(key)) {
+				Value &oldVal = arrayValues[key];
+				arrayCount += ValueTraits::IsEmpty(oldVal);
+				Mover::Assign(oldVal, value);
+				return &oldVal;
+			}
+			return HashSet(key, value);
 		}
 		//find cell with the key (or first empty cell if not present)
 		//note: hash table cannot be null, since IsHashFull returns true in such case
@@ -430,17 +567,25 @@ private:
 		if (!newElement)
 			hashValues[cell].~Value();
 		//move-construct the value in hash table from parameter
-		new (&hashValues[cell]) Value(AWH_MOVE(value));
+		Mover::Construct(&hashValues[cell], value);
 		//return pointer to the updated value
 		return &hashValues[cell];
 	}
 
 	//(very similar to HashSet)
-	AWH_NOINLINE Value *HashSetIfNew(Key key, Value value) {
+	AWH_NOINLINE Value *HashSetIfNew(Key key, Value &value) {
 		if (IsHashFull(hashFill, hashSize)) {
 			//fill ratio is capped: reallocate and proceed as usual
 			AdaptSizes(key);
-			return SetIfNew(key, AWH_MOVE(value));
+			if (InArray(key)) {
+				Value &oldVal = arrayValues[key];
+				if (!ValueTraits::IsEmpty(oldVal))
+					return &oldVal;
+				Mover::Assign(oldVal, value);
+				arrayCount++;
+				return NULL;
+			}
+			return HashSetIfNew(key, value);
 		}
 		Size cell = FindCellKeyOrEmpty(key);
 		//if the element is not new, then simply return pointer to it
@@ -450,10 +595,16 @@ private:
 		hashFill++;
 		hashCount++;
 		hashKeys[cell] = key;
-		new (&hashValues[cell]) Value(AWH_MOVE(value));
+		Mover::Construct(&hashValues[cell], value);
 		return NULL;
 	}
 
+	//must be called when element with given key is removed (see Length)
+	AWH_INLINE void ShrinkBorder(Key key) {
+		if (Size(key) < border)
+			border = Size(key);
+	}
+
 	AWH_NOINLINE void HashRemove(Key key) {
 		//check for null required: FindCellXXX hangs otherwise
 		if (hashSize == 0)
@@ -463,6 +614,7 @@ private:
 		//if key was not found, then do nothing
 		if (hashKeys[cell] == EMPTY_KEY)
 			return;
+		ShrinkBorder(key);
 		//mark cell of hash table as REMOVED
 		hashKeys[cell] = REMOVED_KEY;
 		hashCount--;
@@ -470,10 +622,27 @@ private:
 		hashValues[cell].~Value();
 	}
 
+	//find element with given index in order of cells (used rarely)
+	AWH_NOINLINE Value *FindElementByIndex(Size idx) const {
+		assert(idx < arrayCount + hashCount);
+		if (idx < arrayCount) {
+			for (Size i = 0; ; i++)
+				if (!ValueTraits::IsEmpty(arrayValues[i]) && idx-- == 0)
+					return &arrayValues[i];
+		}
+		idx -= arrayCount;
+		for (Size i = 0; ; i++) {
+			Key key = hashKeys[i];
+			if (key != EMPTY_KEY && key != REMOVED_KEY && idx-- == 0)
+				return &hashValues[i];
+		}
+	}
+
 	AWH_NOINLINE void HashRemovePtr(Value *ptr) {
 		//determine cell index
 		size_t cell = ptr - &hashValues[0];
 		assert(hashKeys[cell] != EMPTY_KEY && hashKeys[cell] != REMOVED_KEY);
+		ShrinkBorder(hashKeys[cell]);
 		//mark cell of hash table as REMOVED
 		hashKeys[cell] = REMOVED_KEY;
 		hashCount--;
@@ -481,6 +650,172 @@ private:
 		hashValues[cell].~Value();
 	}
 
+	//======================================================================
+	//Bulk operations with another container are implemented here.
+	//Each element is checked for presence in the other container,
+	//and memory for the keys looked up ahead is prefetched.
+
+	//remove all elements of this container, which are present (if REMOVE_PRESENT)
+	//or not present (if !REMOVE_PRESENT) in the other container
+	template<bool REMOVE_PRESENT> AWH_NOINLINE void RemoveByPresence(const ArrayWithHash &other) {
+		//overlapping range of array parts: walk both arrays in lockstep
+		Size common = std::min(arraySize, other.arraySize);
+		for (Size i = 0; i < common; i++) {
+			bool present = !ValueTraits::IsEmpty(other.arrayValues[i]);
+			if (present == REMOVE_PRESENT && !ValueTraits::IsEmpty(arrayValues[i])) {
+				ShrinkBorder(Key(i));
+				arrayValues[i] = ValueTraits::GetEmpty();
+				arrayCount--;
+			}
+		}
+		//rest of the array part: keys are in the hash part of other container
+		for (Size i = common; i < arraySize; i++) {
+			if (i + PREFETCH_DISTANCE < arraySize)
+				other.Prefetch(Key(i + PREFETCH_DISTANCE));
+			if (ValueTraits::IsEmpty(arrayValues[i]))
+				continue;
+			bool present = (other.HashGetPtr(Key(i)) != NULL);
+			if (present == REMOVE_PRESENT) {
+				ShrinkBorder(Key(i));
+				arrayValues[i] = ValueTraits::GetEmpty();
+				arrayCount--;
+			}
+		}
+		//hash part: keys can be in any part of other container
+		for (Size i = 0; i < hashSize; i++) {
+			if (i + PREFETCH_DISTANCE < hashSize)
+				other.Prefetch(hashKeys[i + PREFETCH_DISTANCE]);
+			Key key = hashKeys[i];
+			if (key == EMPTY_KEY || key == REMOVED_KEY)
+				continue;
+			bool present = (other.GetPtr(key) != NULL);
+			if (present == REMOVE_PRESENT)
+				HashRemovePtr(&hashValues[i]);
+		}
+	}
+
+	//======================================================================
+	//Helper for renumbering keys (see Compact).
+
+	//action for ForEachSorted: moves each element into the array part of res
+	//with key equal to the number of elements visited before it
+	template<class Mapping> struct CompactAction {
+		ArrayWithHash *res;
+		Mapping *oldToNew;
+		Size next;
+		AWH_INLINE bool operator() (Key key, Value &value) {
+			Mover::Assign(res->arrayValues[next], value);
+			oldToNew->Set(key, Key(next));
+			next++;
+			return false;
+		}
+	};
+
+	//======================================================================
+	//Helpers for columnar export are implemented here.
+
+	//write all elements of array part into columns, returns number of elements written
+	AWH_INLINE Size ExportArrayPart(Key *keys, Value *values) const {
+		Size pos = 0;
+		if (IsTriviallyCopyable<Value>::value) {
+			//branchless stream compaction: each cell is written, but pointer advances on non-empty only
+			//note: loop stops right after the last element is written, so no write is out of bounds
+			for (Size i = 0; pos < arrayCount; i++) {
+				keys[pos] = Key(i);
+				values[pos] = arrayValues[i];
+				pos += !ValueTraits::IsEmpty(arrayValues[i]);
+			}
+		}
+		else {
+			for (Size i = 0; i < arraySize; i++)
+				if (!ValueTraits::IsEmpty(arrayValues[i])) {
+					keys[pos] = Key(i);
+					values[pos] = arrayValues[i];
+					pos++;
+				}
+		}
+		return pos;
+	}
+
+	//comparator of hash cells by their keys
+	struct HashCellLess {
+		const Key *hashKeys;
+		AWH_INLINE bool operator() (Size a, Size b) const {
+			return hashKeys[a] < hashKeys[b];
+		}
+	};
+	//sort given indices of hash cells by their keys with LSD radix sort (one byte per pass)
+	AWH_NOINLINE void RadixSortHashCells(Size *cells, Size cnt) const {
+		//keys are mapped to unsigned integers with the same order (sign bit is flipped if signed)
+		const Size signBit = (Key(-1) < Key(0) ? Size(Size(1) << (BITS - 1)) : Size(0));
+		Size *buffer = AllocateBuffer<Size>(3 * cnt);
+		Size *srcCells = cells, *srcOrd = buffer;
+		Size *dstCells = buffer + cnt, *dstOrd = buffer + 2 * cnt;
+		for (Size i = 0; i < cnt; i++)
+			srcOrd[i] = Size(hashKeys[cells[i]]) ^ signBit;
+		for (int shift = 0; shift < BITS; shift += 8) {
+			Size histo[256] = {0};
+			for (Size i = 0; i < cnt; i++)
+				histo[(srcOrd[i] >> shift) & 255]++;
+			//all keys have the same byte: nothing to do in this pass
+			if (histo[(srcOrd[0] >> shift) & 255] == cnt)
+				continue;
+			Size sum = 0;
+			for (int d = 0; d < 256; d++) {
+				Size tmp = histo[d];
+				histo[d] = sum;
+				sum += tmp;
+			}
+			for (Size i = 0; i < cnt; i++) {
+				Size pos = histo[(srcOrd[i] >> shift) & 255]++;
+				dstOrd[pos] = srcOrd[i];
+				dstCells[pos] = srcCells[i];
+			}
+			std::swap(srcCells, dstCells);
+			std::swap(srcOrd, dstOrd);
+		}
+		if (srcCells != cells)
+			memcpy(cells, srcCells, size_t(cnt) * sizeof(Size));
+		DeallocateBuffer<Size>(buffer);
+	}
+
+	//fill given buffer with indices of all valid cells of hash part, sorted by their keys
+	//returns number of keys which must go before the array part (i.e. negative keys)
+	AWH_NOINLINE Size SortHashCells(Size *cells) const {
+		Size cnt = 0, i = 0;
+		for (; i + Size(SIMD_BLOCK) <= hashSize; i += Size(SIMD_BLOCK))
+			for (uint32_t mask = HashValidMask(i); mask; mask &= mask - 1)
+				cells[cnt++] = i + ctz(mask);
+		for (; i < hashSize; i++)
+			if (hashKeys[i] != EMPTY_KEY && hashKeys[i] != REMOVED_KEY)
+				cells[cnt++] = i;
+		assert(cnt == hashCount);
+		if (cnt >= Size(RADIX_SORT_MIN))
+			RadixSortHashCells(cells, cnt);
+		else {
+			HashCellLess less = {hashKeys};
+			std::sort(cells, cells + cnt, less);
+		}
+		Size neg = 0;
+		while (neg < cnt && hashKeys[cells[neg]] < Key(0))
+			neg++;
+		return neg;
+	}
+
+	//check whether cells [from; from + cnt) of array parts of both containers are bitwise equal
+	//used to skip unchanged blocks quickly, returns false if bitwise equality may differ from
+	//operator == (e.g. for floating point values), so that results never depend on cell position
+	AWH_INLINE bool ArrayBlockIdentical(const ArrayWithHash &other, Size from, Size cnt) const {
+		if (!IsBitwiseComparable<Value>::value)
+			return false;
+		return memcmp(arrayValues + from, other.arrayValues + from, size_t(cnt) * sizeof(Value)) == 0;
+	}
+
+	//check whether value is equal to the one found in other container (NULL if missing)
+	static AWH_INLINE bool SameElement(const Value &value, const Value *otherValue) {
+		return otherValue && *otherValue == value;
+	}
+
 	//======================================================================
 
 	//initialize all members of this object to empty state
@@ -490,6 +825,7 @@ private:
 		arrayCount = 0;
 		hashCount = 0;
 		hashFill = 0;
+		border = 0;
 		arrayValues = NULL;
 		hashValues = NULL;
 		hashKeys = NULL;
@@ -501,6 +837,7 @@ private:
 		arrayCount = iSource.arrayCount;
 		hashCount = iSource.hashCount;
 		hashFill = iSource.hashFill;
+		border = iSource.border;
 		arrayValues = iSource.arrayValues;
 		hashValues = iSource.hashValues;
 		hashKeys = iSource.hashKeys;
@@ -508,7 +845,13 @@ private:
 	//call destructor for all the values still alive in hash table part
 	//used for whole-object clearing
 	AWH_INLINE void DestroyAllHashValues() {
-		for (Size i = 0; i < hashSize; i++)
+		if (IsTriviallyDestructible<Value>::value)
+			return;
+		Size i = 0;
+		for (; i + Size(SIMD_BLOCK) <= hashSize; i += Size(SIMD_BLOCK))
+			for (uint32_t mask = HashValidMask(i); mask; mask &= mask - 1)
+				hashValues[i + ctz(mask)].~Value();
+		for (; i < hashSize; i++)
 			if (hashKeys[i] != EMPTY_KEY && hashKeys[i] != REMOVED_KEY)
 				hashValues[i].~Value();
 	}
@@ -556,11 +899,62 @@ public:
 		std::swap(hashSize, other.hashSize);
 		std::swap(hashCount, other.hashCount);
 		std::swap(hashFill, other.hashFill);
+		std::swap(border, other.border);
 		std::swap(arrayValues, other.arrayValues);
 		std::swap(hashValues, other.hashValues);
 		std::swap(hashKeys, other.hashKeys);
 	}
 
+	//make target container an exact copy of this one (old contents of target are destroyed)
+	//all buffers are copied as a whole, so no rehashing is done
+	//memcpy is used for trivially copyable values, and copy constructor is used otherwise
+	//note: Value must be copyable, otherwise this method won't compile
+	AWH_NOINLINE void CloneTo(ArrayWithHash &target) const {
+		if (&target == this)
+			return;
+		//build copy in a temporary object, then swap it into target
+		ArrayWithHash res;
+		//array part: all elements are alive (EMPTY values included)
+		res.arrayValues = AllocateBuffer<Value>(arraySize);
+		std::uninitialized_copy(arrayValues, arrayValues + arraySize, res.arrayValues);
+		res.arraySize = arraySize;
+		res.arrayCount = arrayCount;
+		res.hashKeys = AllocateBuffer<Key>(hashSize);
+		res.hashValues = AllocateBuffer<Value>(hashSize);
+		res.hashSize = hashSize;
+		if (IsTriviallyCopyable<Value>::value) {
+			//keys are integers, so they are always copied with memcpy
+			//note: values in empty cells are copied too (they are never read)
+			if (hashSize) {
+				memcpy(res.hashKeys, hashKeys, size_t(hashSize) * sizeof(Key));
+				memcpy((void*)res.hashValues, (void*)hashValues, size_t(hashSize) * sizeof(Value));
+			}
+		}
+		else {
+			//only values of valid elements are alive
+			//note: key is set after its value is constructed, so if copy constructor throws,
+			//then destructor of temporary object destroys exactly the values constructed so far
+			FillEmptyKeys(res.hashKeys, hashSize);
+			for (Size i = 0; i < hashSize; i++) {
+				if (hashKeys[i] != EMPTY_KEY && hashKeys[i] != REMOVED_KEY)
+					new (&res.hashValues[i]) Value(hashValues[i]);
+				res.hashKeys[i] = hashKeys[i];
+			}
+		}
+		res.hashCount = hashCount;
+		res.hashFill = hashFill;
+		res.border = border;
+		target.Swap(res);
+	}
+#ifndef AWH_NO_CPP11
+	//return an exact copy of this container (see CloneTo)
+	ArrayWithHash Clone() const {
+		ArrayWithHash res;
+		CloneTo(res);
+		return res;
+	}
+#endif
+
 	//remove all elements from container without shrinking
 	//note: if you want to free resources, use the well-known swap hack:
 	//  container.Swap(ArrayWithHash<...>());
@@ -568,18 +962,23 @@ public:
 		//note: if array is already empty, no action is required
 		if (arraySize && arrayCount) {
 			//make all values EMPTY
-			for (Size i = 0; i < arraySize; i++)
-				arrayValues[i] = AWH_MOVE(ValueTraits::GetEmpty());
+			if (IsTriviallyCopyable<Value>::value)
+				//old values need no destruction, so they are simply overwritten
+				ConstructEmptyValues(arrayValues, arraySize);
+			else {
+				for (Size i = 0; i < arraySize; i++)
+					arrayValues[i] = AWH_MOVE(ValueTraits::GetEmpty());
+			}
 		}
 		//note: if hash table is already empty, no action is required
 		if (hashSize && hashFill) {
 			//destroy all the alive values of valid elements
 			DestroyAllHashValues();
 			//make all cells empty
-			std::fill_n(hashKeys, hashSize, Key(EMPTY_KEY));
+			FillEmptyKeys(hashKeys, hashSize);
 		}
 		//reset all element counters
-		arrayCount = hashCount = hashFill = 0;
+		arrayCount = hashCount = hashFill = border = 0;
 	}
 
 	//return number of elements currently inside
@@ -610,6 +1009,30 @@ public:
 			return HashGetPtr(key);
 	}
 
+	//prefetch memory which would be accessed when looking up the given key
+	//call it well in advance in order to hide memory latency
+	AWH_INLINE void Prefetch(Key key) const {
+		if (InArray(key))
+			AWH_PREFETCH(&arrayValues[key]);
+		else if (hashSize) {
+			Size cell = KeyTraits::HashFunction(key) & (hashSize - 1);
+			AWH_PREFETCH(&hashKeys[cell]);
+			AWH_PREFETCH(&hashValues[cell]);
+		}
+	}
+
+	//look up several keys at once: results[i] = GetPtr(keys[i])
+	//memory for the keys is prefetched ahead, so lookups are overlapped
+	AWH_NOINLINE void GetPtrBatch(const Key *keys, Size count, Value **results) const {
+		for (Size i = 0; i < count && i < PREFETCH_DISTANCE; i++)
+			Prefetch(keys[i]);
+		for (Size i = 0; i < count; i++) {
+			if (i + PREFETCH_DISTANCE < count)
+				Prefetch(keys[i + PREFETCH_DISTANCE]);
+			results[i] = GetPtr(keys[i]);
+		}
+	}
+
 	//set the value associated with the given key
 	//the key is inserted if not present before
 	//returns pointer to the updated/inserted value
@@ -619,11 +1042,11 @@ public:
 		if (InArray(key)) {
 			Value &oldVal = arrayValues[key];
 			arrayCount += ValueTraits::IsEmpty(oldVal);	//branchless
-			oldVal = AWH_MOVE(value);
+			Mover::Assign(oldVal, value);
 			return &oldVal;
 		}
 		else
-			return HashSet(key, AWH_MOVE(value));
+			return HashSet(key, value);
 	}
 
 	//if key is present, then returns pointer to it
@@ -634,7 +1057,7 @@ public:
 		if (InArray(key)) {
 			Value &oldVal = arrayValues[key];
 			if (ValueTraits::IsEmpty(oldVal)) {					//real branch
-				oldVal = AWH_MOVE(value);
+				Mover::Assign(oldVal, value);
 				arrayCount++;
 				return NULL;
 			}
@@ -650,7 +1073,7 @@ public:
 			return empty ? NULL : pOldVal;*/
 		}
 		else
-			return HashSetIfNew(key, AWH_MOVE(value));
+			return HashSetIfNew(key, value);
 	}
 
 	//remove element with the given key (if present)
@@ -661,6 +1084,7 @@ public:
 			arrayCount -= !ValueTraits::IsEmpty(val);	//branchless
 			//note: value is reset to EMPTY state in the array part
 			val = ValueTraits::GetEmpty();
+			ShrinkBorder(key);
 		}
 		else
 			HashRemove(key);
@@ -674,11 +1098,40 @@ public:
 			arrayCount--;
 			//reset value to EMPTY state
 			*ptr = ValueTraits::GetEmpty();
+			ShrinkBorder(Key(ptr - arrayValues));
 		}
 		else
 			HashRemovePtr(ptr);
 	}
 
+	//return length of the dense prefix: maximal k such that all keys 0, 1, ..., k-1 are present
+	//it is the first border of the table in terms of Lua (i.e. the value of # operator)
+	//note: border is repaired lazily after removals, so Length takes amortized O(1) time
+	//as long as elements are only appended (no removals of keys below the border)
+	//note: Length is not const, since it advances the cached border (so it is not thread-safe)
+	AWH_INLINE Size Length() {
+		while (InArray(Key(border)) ? !ValueTraits::IsEmpty(arrayValues[border]) : HashGetPtr(Key(border)) != NULL)
+			border++;
+		return border;
+	}
+
+	//insert value with key = Length(), i.e. right after the dense prefix
+	//returns the key of inserted element (useful for allocating IDs)
+	AWH_INLINE Key PushBack(Value value) {
+		assert(!ValueTraits::IsEmpty(value));
+		Key key = Key(Length());
+		//note: key can hit special values or wrap around if Key type is too narrow
+		assert(key != EMPTY_KEY && key != REMOVED_KEY && Size(key) == border);
+		if (InArray(key)) {
+			Mover::Assign(arrayValues[key], value);
+			arrayCount++;
+		}
+		else
+			HashSet(key, value);
+		border++;
+		return key;
+	}
+
 	//get key for the given value pointer
 	//this method allows to use value pointers as iterators
 	AWH_INLINE Key KeyOf(Value *ptr) const {
@@ -691,6 +1144,56 @@ public:
 		}
 	}
 
+	//return total number of cells in both parts of the container
+	//array cells are numbered first: [0..arraySize), then hash cells go: [arraySize..arraySize+hashSize)
+	//note: cell numbers are invalidated by any reallocation (see WillReallocateOnInsert)
+	AWH_INLINE Size GetCellsCount() const {
+		return arraySize + hashSize;
+	}
+	//get number of cell which holds the given value pointer
+	AWH_INLINE Size CellOf(Value *ptr) const {
+		assert(ptr);
+		if (InArray(ptr))
+			return Size(ptr - arrayValues);
+		else
+			return arraySize + Size(ptr - hashValues);
+	}
+	//get pointer to the value in the given cell, or NULL if the cell contains no element
+	AWH_INLINE Value *PtrOfCell(Size cell) const {
+		assert(cell < arraySize + hashSize);
+		if (cell < arraySize) {
+			Value *ptr = &arrayValues[cell];
+			return ValueTraits::IsEmpty(*ptr) ? NULL : ptr;
+		}
+		cell -= arraySize;
+		Key key = hashKeys[cell];
+		return (key == EMPTY_KEY || key == REMOVED_KEY) ? NULL : &hashValues[cell];
+	}
+	//check whether inserting given key with Set may reallocate memory (and thus renumber cells)
+	//note: it is conservative, i.e. true may be returned even if no reallocation happens
+	AWH_INLINE bool WillReallocateOnInsert(Key key) const {
+		return !InArray(key) && IsHashFull(hashFill, hashSize);
+	}
+
+#ifndef AWH_NO_CPP11
+	//return pointer to a uniformly random element, or NULL if container is empty
+	//rng must be a uniform random bit generator (e.g. std::mt19937)
+	//random cell of both parts is drawn until a nonempty one is found,
+	//so expected time is O(1 / fill ratio); if it is unlucky SAMPLE_ATTEMPTS times in a row
+	//(which happens mostly when fill ratio is tiny), then random element is found by scanning
+	template<class Rng> AWH_INLINE Value *SampleRandom(Rng &rng) const {
+		Size count = arrayCount + hashCount;
+		if (count == 0)
+			return NULL;
+		std::uniform_int_distribution<size_t> cellDist(0, size_t(arraySize) + size_t(hashSize) - 1);
+		for (size_t attempt = 0; attempt < SAMPLE_ATTEMPTS; attempt++)
+			if (Value *ptr = PtrOfCell(Size(cellDist(rng))))
+				return ptr;
+		size_t idx = std::uniform_int_distribution<size_t>(0, size_t(count) - 1)(rng);
+		return FindElementByIndex(Size(idx));
+	}
+#endif
+
 	//force to reserve some memory for both array and hash table parts
 	//  arraySizeLB: lower bound on number of elements in the array part
 	//   hashSizeLB: lower bound on number of cells in the hash table part
@@ -710,6 +1213,306 @@ public:
 		Reallocate(arraySizeLB, hashSizeLB);
 	}
 
+	//insert copies of all elements of other container with keys not present in this one
+	//values of elements with common keys are not changed (i.e. this container has priority)
+	//memory for all new elements is reserved at once, so at most one reallocation happens
+	//note: Value must be copyable, otherwise this method won't compile
+	AWH_NOINLINE void UniteWith(const ArrayWithHash &other) {
+		if (&other == this || other.GetSize() == 0)
+			return;
+
+		//=== count new elements and populate histogram of resulting keys ===
+		Size logHisto[BITS + 1] = {0};
+		FillLogHisto(logHisto);
+		Size added = 0;
+		//overlapping range of array parts: walk both arrays in lockstep
+		Size common = std::min(arraySize, other.arraySize);
+		for (Size i = 0; i < common; i++)
+			added += (!ValueTraits::IsEmpty(other.arrayValues[i]) && ValueTraits::IsEmpty(arrayValues[i]));
+		logHisto[log2up(arraySize)] += added;
+		//rest of other's array part: keys are in the hash part of this container
+		for (Size i = common; i < other.arraySize; i++) {
+			if (i + PREFETCH_DISTANCE < other.arraySize)
+				Prefetch(Key(i + PREFETCH_DISTANCE));
+			if (!ValueTraits::IsEmpty(other.arrayValues[i]) && !HashGetPtr(Key(i))) {
+				AddToLogHisto(logHisto, Key(i));
+				added++;
+			}
+		}
+		//other's hash part: keys can be in any part of this container
+		for (Size i = 0; i < other.hashSize; i++) {
+			if (i + PREFETCH_DISTANCE < other.hashSize)
+				Prefetch(other.hashKeys[i + PREFETCH_DISTANCE]);
+			Key key = other.hashKeys[i];
+			if (key == EMPTY_KEY || key == REMOVED_KEY)
+				continue;
+			if (!GetPtr(key)) {
+				AddToLogHisto(logHisto, key);
+				added++;
+			}
+		}
+		if (added == 0)
+			return;
+
+		//=== reserve memory for all the new elements ===
+		Size newArraySize, newHashSize;
+		ChooseSizes(logHisto, GetSize() + added, newArraySize, newHashSize);
+		if (newArraySize != arraySize || newHashSize != hashSize || IsHashFull(Size(hashFill + added), hashSize))
+			Reallocate(newArraySize, newHashSize);
+
+		//=== insert the new elements ===
+		common = std::min(arraySize, other.arraySize);
+		for (Size i = 0; i < common; i++)
+			if (ValueTraits::IsEmpty(arrayValues[i]) && !ValueTraits::IsEmpty(other.arrayValues[i])) {
+				arrayValues[i] = other.arrayValues[i];
+				arrayCount++;
+			}
+		for (Size i = common; i < other.arraySize; i++) {
+			if (i + PREFETCH_DISTANCE < other.arraySize)
+				Prefetch(Key(i + PREFETCH_DISTANCE));
+			if (!ValueTraits::IsEmpty(other.arrayValues[i]))
+				SetIfNew(Key(i), other.arrayValues[i]);
+		}
+		for (Size i = 0; i < other.hashSize; i++) {
+			if (i + PREFETCH_DISTANCE < other.hashSize)
+				Prefetch(other.hashKeys[i + PREFETCH_DISTANCE]);
+			Key key = other.hashKeys[i];
+			if (key != EMPTY_KEY && key != REMOVED_KEY)
+				SetIfNew(key, other.hashValues[i]);
+		}
+	}
+
+	//remove all elements with keys not present in other container
+	AWH_NOINLINE void IntersectWith(const ArrayWithHash &other) {
+		if (&other == this)
+			return;
+		RemoveByPresence<false>(other);
+	}
+
+	//remove all elements with keys present in other container
+	AWH_NOINLINE void Subtract(const ArrayWithHash &other) {
+		if (&other == this)
+			return Clear();
+		if (GetSize() <= other.GetSize())
+			//look up each element of this container in other
+			return RemoveByPresence<true>(other);
+
+		//other container is smaller: remove each of its elements from this container
+		Size common = std::min(arraySize, other.arraySize);
+		for (Size i = 0; i < common; i++)
+			if (!ValueTraits::IsEmpty(other.arrayValues[i]) && !ValueTraits::IsEmpty(arrayValues[i])) {
+				ShrinkBorder(Key(i));
+				arrayValues[i] = ValueTraits::GetEmpty();
+				arrayCount--;
+			}
+		for (Size i = common; i < other.arraySize; i++) {
+			if (i + PREFETCH_DISTANCE < other.arraySize)
+				Prefetch(Key(i + PREFETCH_DISTANCE));
+			if (!ValueTraits::IsEmpty(other.arrayValues[i]))
+				HashRemove(Key(i));
+		}
+		for (Size i = 0; i < other.hashSize; i++) {
+			if (i + PREFETCH_DISTANCE < other.hashSize)
+				Prefetch(other.hashKeys[i + PREFETCH_DISTANCE]);
+			Key key = other.hashKeys[i];
+			if (key != EMPTY_KEY && key != REMOVED_KEY)
+				Remove(key);
+		}
+	}
+
+	//write all elements into two columns: (keys[i], values[i]) for i < GetSize()
+	//both arrays must have space for GetSize() elements, values are assigned to
+	//if sorted is true, then elements are ordered by key, otherwise order is arbitrary
+	//array part is written first with branchless compaction (for trivially copyable values)
+	//returns number of elements written
+	//note: Value must be copyable, otherwise this method won't compile
+	AWH_NOINLINE Size ExportColumns(Key *keys, Value *values, bool sorted = false) const {
+		if (!sorted) {
+			Size pos = ExportArrayPart(keys, values);
+			for (Size i = 0; i < hashSize; i++) {
+				Key key = hashKeys[i];
+				if (key == EMPTY_KEY || key == REMOVED_KEY)
+					continue;
+				keys[pos] = key;
+				values[pos] = hashValues[i];
+				pos++;
+			}
+			return pos;
+		}
+		//keys of hash part are outside of array part range, so they are either
+		//negative (go before array part) or too large (go after array part)
+		Size *cells = AllocateBuffer<Size>(hashCount);
+		Size neg = SortHashCells(cells);
+		Size pos = 0;
+		for (Size j = 0; j < neg; j++, pos++) {
+			keys[pos] = hashKeys[cells[j]];
+			values[pos] = hashValues[cells[j]];
+		}
+		pos += ExportArrayPart(keys + pos, values + pos);
+		for (Size j = neg; j < hashCount; j++, pos++) {
+			keys[pos] = hashKeys[cells[j]];
+			values[pos] = hashValues[cells[j]];
+		}
+		DeallocateBuffer<Size>(cells);
+		return pos;
+	}
+
+	//insert all elements given as two columns: (keys[i], values[i]) for i < count
+	//memory for all elements is reserved at once, so at most one reallocation happens
+	//existing elements are overwritten, if key is repeated then the last value is used
+	//note: Value must be copyable, otherwise this method won't compile
+	AWH_NOINLINE void ImportColumns(const Key *keys, const Value *values, Size count) {
+		if (count == 0)
+			return;
+
+		//=== collect distinct keys which are not present yet ===
+		//note: keys counted several times would make array part look denser than it is
+		Key *added = AllocateBuffer<Key>(count);
+		Size addedCount = 0;
+		for (Size i = 0; i < count; i++) {
+			assert(keys[i] != EMPTY_KEY && keys[i] != REMOVED_KEY);
+			if (i + PREFETCH_DISTANCE < count)
+				Prefetch(keys[i + PREFETCH_DISTANCE]);
+			if (!GetPtr(keys[i]))
+				added[addedCount++] = keys[i];
+		}
+		std::sort(added, added + addedCount);
+		addedCount = Size(std::unique(added, added + addedCount) - added);
+
+		//=== choose sizes from histogram of old and new keys ===
+		Size logHisto[BITS + 1] = {0};
+		FillLogHisto(logHisto);
+		for (Size i = 0; i < addedCount; i++)
+			AddToLogHisto(logHisto, added[i]);
+		Size newArraySize, newHashSize;
+		ChooseSizes(logHisto, GetSize() + addedCount, newArraySize, newHashSize);
+		Size hashAdded = 0;
+		for (Size i = 0; i < addedCount; i++)
+			hashAdded += (Size(added[i]) >= newArraySize);
+		DeallocateBuffer<Key>(added);
+		if (newArraySize != arraySize || newHashSize != hashSize || IsHashFull(Size(hashFill + hashAdded), hashSize))
+			Reallocate(newArraySize, newHashSize);
+
+		//=== insert all the elements ===
+		for (Size i = 0; i < count; i++) {
+			if (i + PREFETCH_DISTANCE < count)
+				Prefetch(keys[i + PREFETCH_DISTANCE]);
+			Set(keys[i], values[i]);
+		}
+	}
+
+	//check whether both containers have the same set of keys with equal values
+	//values are compared with operator == (so NaN is never equal to anything)
+	//overlapping range of array parts is compared with memcmp for integers, enums and pointers
+	//note: Value must be comparable with operator ==
+	AWH_NOINLINE bool Equals(const ArrayWithHash &other) const {
+		if (&other == this)
+			return true;
+		if (GetSize() != other.GetSize())
+			return false;
+		//overlapping range of array parts: compare block by block
+		Size common = std::min(arraySize, other.arraySize);
+		for (Size b = 0; b < common; b += Size(COMPARE_BLOCK)) {
+			Size e = std::min(Size(b + COMPARE_BLOCK), common);
+			if (ArrayBlockIdentical(other, b, e - b))
+				continue;
+			for (Size i = b; i < e; i++) {
+				bool empty = ValueTraits::IsEmpty(arrayValues[i]);
+				if (empty != ValueTraits::IsEmpty(other.arrayValues[i]))
+					return false;
+				if (!empty && !(arrayValues[i] == other.arrayValues[i]))
+					return false;
+			}
+		}
+		//rest of the array part: keys are in the hash part of other container
+		for (Size i = common; i < arraySize; i++) {
+			if (i + PREFETCH_DISTANCE < arraySize)
+				other.Prefetch(Key(i + PREFETCH_DISTANCE));
+			if (!ValueTraits::IsEmpty(arrayValues[i]))
+				if (!SameElement(arrayValues[i], other.HashGetPtr(Key(i))))
+					return false;
+		}
+		//hash part: keys can be in any part of other container
+		for (Size i = 0; i < hashSize; i++) {
+			if (i + PREFETCH_DISTANCE < hashSize)
+				other.Prefetch(hashKeys[i + PREFETCH_DISTANCE]);
+			Key key = hashKeys[i];
+			if (key != EMPTY_KEY && key != REMOVED_KEY)
+				if (!SameElement(hashValues[i], other.GetPtr(key)))
+					return false;
+		}
+		//sizes are equal and all elements of this are in other, so the key sets are equal
+		return true;
+	}
+
+	//compute difference between this (old) container and the newer one
+	//callbacks are specified as functors with signatures:
+	//  void onAdded(Key key, Value &newValue);                    //key present only in newer
+	//  void onRemoved(Key key, Value &oldValue);                  //key present only in this
+	//  void onChanged(Key key, Value &oldValue, Value &newValue); //values differ
+	//elements with equal values are skipped silently (see Equals), order of reports is arbitrary
+	//note: Value must be comparable with operator ==
+	template<class Added, class Removed, class Changed>
+	AWH_NOINLINE void Diff(const ArrayWithHash &newer, Added &onAdded, Removed &onRemoved, Changed &onChanged) const {
+		if (&newer == this)
+			return;
+		//overlapping range of array parts: compare block by block
+		Size common = std::min(arraySize, newer.arraySize);
+		for (Size b = 0; b < common; b += Size(COMPARE_BLOCK)) {
+			Size e = std::min(Size(b + COMPARE_BLOCK), common);
+			if (ArrayBlockIdentical(newer, b, e - b))
+				continue;
+			for (Size i = b; i < e; i++) {
+				bool oldEmpty = ValueTraits::IsEmpty(arrayValues[i]);
+				bool newEmpty = ValueTraits::IsEmpty(newer.arrayValues[i]);
+				if (oldEmpty && !newEmpty)
+					onAdded(Key(i), newer.arrayValues[i]);
+				else if (!oldEmpty && newEmpty)
+					onRemoved(Key(i), arrayValues[i]);
+				else if (!oldEmpty && !(arrayValues[i] == newer.arrayValues[i]))
+					onChanged(Key(i), arrayValues[i], newer.arrayValues[i]);
+			}
+		}
+		//elements of this container out of common range: removed or changed
+		for (Size i = common; i < arraySize; i++) {
+			if (i + PREFETCH_DISTANCE < arraySize)
+				newer.Prefetch(Key(i + PREFETCH_DISTANCE));
+			if (ValueTraits::IsEmpty(arrayValues[i]))
+				continue;
+			Value *newValue = newer.HashGetPtr(Key(i));
+			if (!newValue)
+				onRemoved(Key(i), arrayValues[i]);
+			else if (!(arrayValues[i] == *newValue))
+				onChanged(Key(i), arrayValues[i], *newValue);
+		}
+		for (Size i = 0; i < hashSize; i++) {
+			if (i + PREFETCH_DISTANCE < hashSize)
+				newer.Prefetch(hashKeys[i + PREFETCH_DISTANCE]);
+			Key key = hashKeys[i];
+			if (key == EMPTY_KEY || key == REMOVED_KEY)
+				continue;
+			Value *newValue = newer.GetPtr(key);
+			if (!newValue)
+				onRemoved(key, hashValues[i]);
+			else if (!(hashValues[i] == *newValue))
+				onChanged(key, hashValues[i], *newValue);
+		}
+		//elements of newer container out of common range: only additions are reported here
+		for (Size i = common; i < newer.arraySize; i++) {
+			if (i + PREFETCH_DISTANCE < newer.arraySize)
+				Prefetch(Key(i + PREFETCH_DISTANCE));
+			if (!ValueTraits::IsEmpty(newer.arrayValues[i]) && !HashGetPtr(Key(i)))
+				onAdded(Key(i), newer.arrayValues[i]);
+		}
+		for (Size i = 0; i < newer.hashSize; i++) {
+			if (i + PREFETCH_DISTANCE < newer.hashSize)
+				Prefetch(newer.hashKeys[i + PREFETCH_DISTANCE]);
+			Key key = newer.hashKeys[i];
+			if (key != EMPTY_KEY && key != REMOVED_KEY && !GetPtr(key))
+				onAdded(key, newer.hashValues[i]);
+		}
+	}
+
 	//perform given action for all the elements in this container
 	//callback is specified as a functor with signature:
 	//  bool action(Key key, Value &value);
@@ -721,12 +1524,61 @@ public:
 			if (!ValueTraits::IsEmpty(arrayValues[i]))
 				if (action(Key(i), arrayValues[i]))
 					return;
-		for (Size i = 0; i < hashSize; i++)
+		//note: free cells of hash part are skipped by blocks using SIMD
+		Size i = 0;
+		for (; i + Size(SIMD_BLOCK) <= hashSize; i += Size(SIMD_BLOCK))
+			for (uint32_t mask = HashValidMask(i); mask; mask &= mask - 1) {
+				Size cell = i + ctz(mask);
+				if (action(Key(hashKeys[cell]), hashValues[cell]))
+					return;
+			}
+		for (; i < hashSize; i++)
 			if (hashKeys[i] != EMPTY_KEY && hashKeys[i] != REMOVED_KEY)
 				if (action(Key(hashKeys[i]), hashValues[i]))
 					return;
 	}
 
+	//perform given action for all the elements in this container in order of increasing keys
+	//array part is already ordered, so only the keys of hash part are sorted (with radix sort)
+	//hence it is almost as fast as ForEach if most of elements are in the array part
+	//see ForEach for details about callback
+	//note: temporary buffer with one integer per element of hash part is allocated
+	template<class Action> void ForEachSorted(Action &action) const {
+		Size *cells = AllocateBuffer<Size>(hashCount);
+		Size neg = SortHashCells(cells);
+		bool stop = false;
+		//negative keys go first (if Key is signed)
+		for (Size j = 0; j < neg && !stop; j++)
+			stop = action(Key(hashKeys[cells[j]]), hashValues[cells[j]]);
+		for (Size i = 0; i < arraySize && !stop; i++)
+			if (!ValueTraits::IsEmpty(arrayValues[i]))
+				stop = action(Key(i), arrayValues[i]);
+		//keys greater than size of array part go last
+		for (Size j = neg; j < hashCount && !stop; j++)
+			stop = action(Key(hashKeys[cells[j]]), hashValues[cells[j]]);
+		DeallocateBuffer<Size>(cells);
+	}
+
+	//renumber all elements with keys 0, 1, ..., GetSize()-1 preserving order of keys
+	//the container is rebuilt from scratch: all elements are put into the array part,
+	//which is as small as possible (power of two), and hash part is freed
+	//oldToNew.Set(oldKey, newKey) is called for each element (e.g. ArrayWithHash<Key, Key>)
+	//note: all pointers to values are invalidated
+	template<class Mapping> AWH_NOINLINE void Compact(Mapping &oldToNew) {
+		Size count = GetSize();
+		ArrayWithHash res;
+		res.Reserve(count, 0);
+		CompactAction<Mapping> action;
+		action.res = &res;
+		action.oldToNew = &oldToNew;
+		action.next = 0;
+		ForEachSorted(action);
+		res.arrayCount = count;
+		res.border = count;
+		//old elements (moved from) are destroyed together with res
+		Swap(res);
+	}
+
 #ifdef AWH_TESTING
 	//internal method: checks all the invariants of the container
 	//it is not called from anywhere (except tests), and you should not call it too
@@ -763,6 +1615,9 @@ public:
 			}
 			//check array count value
 			AWH_ASSERT_ALWAYS(arrayCount == trueArrayCount);
+			//all keys below the border must be present
+			for (Size i = 0; i < border; i++)
+				AWH_ASSERT_ALWAYS(InArray(Key(i)) ? !ValueTraits::IsEmpty(arrayValues[i]) : HashGetPtr(Key(i)) != NULL);
 
 			//count number of valid elements and number of non-empty cells in hash
 			Size trueHashCount = 0, trueHashFill = 0;
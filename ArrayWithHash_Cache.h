@@ -0,0 +1,220 @@
+//          Copyright Stepan Gatilov 2016.
+// Distributed under the Boost Software License, Version 1.0.
+//      (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "ArrayWithHash.h"
+#include <vector>
+
+//namespace for ArrayWithHash
+namespace AWH_NAMESPACE {
+
+//array with hash table of bounded size, which evicts elements by CLOCK (second chance) policy
+//Each cell of the underlying container has a reference bit in a side bitmap.
+//Reference bit is set when element is accessed (GetPtr, Get, Set of existing key).
+//When a new element is inserted into a full cache, the clock hand sweeps over cells:
+//referenced elements get their bit cleared, and the first unreferenced one is evicted.
+//So cache hit costs the same as ArrayWithHash::GetPtr plus setting one bit.
+//note: newly inserted elements are unreferenced until they are accessed again
+//note: when the underlying container reallocates, reference bits are carried over to new cells
+template<
+	class TKey, class TValue,
+#ifndef AWH_NO_CPP11
+	class TKeyTraits = DefaultKeyTraits<TKey>, class TValueTraits = DefaultValueTraits<TValue>
+#else
+	class TKeyTraits, class TValueTraits
+#endif
+>
+class CacheArrayWithHash {
+public:
+	//accessing template arguments from outside
+	typedef TKey Key;
+	typedef TValue Value;
+	typedef TKeyTraits KeyTraits;
+	typedef TValueTraits ValueTraits;
+	//default unsigned integer type
+	typedef typename KeyTraits::Size Size;
+	//underlying container: key -> value
+	typedef ArrayWithHash<Key, Value, KeyTraits, ValueTraits> ValueMap;
+
+private:
+	//all the elements in cache
+	ValueMap values;
+	//reference bits: one bit per cell of values
+	std::vector<uint64_t> referenced;
+	//maximal number of elements allowed
+	Size capacity;
+	//cell to be checked next during eviction
+	Size hand;
+
+	//set reference bit for the cell of given value
+	AWH_INLINE void Touch(Value *ptr) {
+		Size cell = values.CellOf(ptr);
+		referenced[cell >> 6] |= uint64_t(1) << (cell & 63);
+	}
+
+	//clear all reference bits, adapting bitmap to current cells of values
+	AWH_NOINLINE void ResetReferences() {
+		referenced.assign(size_t((values.GetCellsCount() + 63) >> 6), 0);
+		hand = 0;
+	}
+
+	//clear reference bit for the cell of given value
+	AWH_INLINE void Untouch(Value *ptr) {
+		Size cell = values.CellOf(ptr);
+		referenced[cell >> 6] &= ~(uint64_t(1) << (cell & 63));
+	}
+
+	//return keys of all referenced elements (to restore their bits after reallocation)
+	AWH_NOINLINE std::vector<Key> ReferencedKeys() const {
+		std::vector<Key> res;
+		for (size_t w = 0; w < referenced.size(); w++)
+			for (uint64_t word = referenced[w]; word; word &= word - 1) {
+				Size cell = Size((w << 6) + ctz(word));
+				res.push_back(values.KeyOf(values.PtrOfCell(cell)));
+			}
+		return res;
+	}
+
+	//sweep clock hand until unreferenced element is found, and remove it
+	AWH_NOINLINE void Evict() {
+		assert(values.GetSize() > 0);
+		Size cells = values.GetCellsCount();
+		//note: at most two full turns are possible
+		while (1) {
+			if (hand >= cells)
+				hand = 0;
+			Size cell = hand++;
+			Value *ptr = values.PtrOfCell(cell);
+			if (!ptr)
+				continue;
+			uint64_t &word = referenced[cell >> 6];
+			uint64_t bit = uint64_t(1) << (cell & 63);
+			if (word & bit)
+				word ^= bit;
+			else {
+				values.RemovePtr(ptr);
+				return;
+			}
+		}
+	}
+
+	//note: CacheArrayWithHash is non-copyable (just like ArrayWithHash)
+	CacheArrayWithHash (const CacheArrayWithHash &iSource);
+	void operator= (const CacheArrayWithHash &iSource);
+
+public:
+	//create empty cache, which can hold at most maxCount elements
+	explicit CacheArrayWithHash(Size maxCount) : capacity(maxCount), hand(0) {
+		assert(capacity > 0);
+	}
+
+	//fast O(1) swap of this object and another one
+	void Swap(CacheArrayWithHash &other) {
+		values.Swap(other.values);
+		referenced.swap(other.referenced);
+		std::swap(capacity, other.capacity);
+		std::swap(hand, other.hand);
+	}
+
+	//remove all elements from cache without shrinking
+	AWH_NOINLINE void Clear() {
+		values.Clear();
+		ResetReferences();
+	}
+
+	//return number of elements currently inside
+	AWH_INLINE Size GetSize() const {
+		return values.GetSize();
+	}
+	//return maximal number of elements allowed
+	AWH_INLINE Size GetCapacity() const {
+		return capacity;
+	}
+
+	//return pointer to the value for a given key, or NULL if it is not in cache
+	//element is marked as referenced, so it gets a second chance on eviction
+	AWH_INLINE Value *GetPtr(Key key) {
+		Value *ptr = values.GetPtr(key);
+		if (ptr)
+			Touch(ptr);
+		return ptr;
+	}
+	//return value for a given key (empty value if it is not in cache)
+	//element is marked as referenced, so it gets a second chance on eviction
+	AWH_INLINE Value Get(Key key) {
+		Value *ptr = GetPtr(key);
+		return ptr ? *ptr : ValueTraits::GetEmpty();
+	}
+	//return pointer to the value for a given key without marking it as referenced
+	AWH_INLINE Value *Peek(Key key) const {
+		return values.GetPtr(key);
+	}
+
+	//set value for a given key, returns pointer to the value inside cache
+	//if key is new and cache is full, then some other element is evicted first
+	AWH_INLINE Value *Set(Key key, Value value) {
+		assert(!ValueTraits::IsEmpty(value));
+		Value *ptr = values.GetPtr(key);
+		if (ptr) {
+			*ptr = AWH_MOVE(value);
+			Touch(ptr);
+			return ptr;
+		}
+		if (values.GetSize() >= capacity)
+			Evict();
+		if (!values.WillReallocateOnInsert(key))
+			return values.Set(key, AWH_MOVE(value));
+		//note: cells are renumbered on reallocation, so bitmap must be rebuilt
+		std::vector<Key> keys = ReferencedKeys();
+		ptr = values.Set(key, AWH_MOVE(value));
+		ResetReferences();
+		for (size_t i = 0; i < keys.size(); i++)
+			Touch(values.GetPtr(keys[i]));
+		return ptr;
+	}
+
+	//remove element with given key (if present)
+	//note: reference bit is cleared, so that the key inserted later does not inherit it
+	AWH_INLINE void Remove(Key key) {
+		Value *ptr = values.GetPtr(key);
+		if (!ptr)
+			return;
+		Untouch(ptr);
+		values.RemovePtr(ptr);
+	}
+
+	//read-only access to the underlying container with all elements
+	AWH_INLINE const ValueMap &GetValues() const {
+		return values;
+	}
+
+	//perform given action for all the elements in cache (without marking them as referenced)
+	//callback is specified as a functor with signature:
+	//  bool action(Key key, Value &value);
+	//it must return: false to continue iteration, true to stop it
+	template<class Action> AWH_INLINE void ForEach(Action &action) const {
+		values.ForEach(action);
+	}
+
+#ifdef AWH_TESTING
+	//internal method: checks all the invariants of the container
+	AWH_NOINLINE bool AssertCorrectness(int verbosity = 2) const {
+		values.AssertCorrectness(verbosity);
+		AWH_ASSERT_ALWAYS(values.GetSize() <= capacity);
+		AWH_ASSERT_ALWAYS(Size(referenced.size()) == ((values.GetCellsCount() + 63) >> 6));
+		if (verbosity >= 1) {
+			//only cells with elements can be referenced
+			for (Size cell = 0; cell < values.GetCellsCount(); cell++)
+				if (referenced[cell >> 6] & (uint64_t(1) << (cell & 63)))
+					AWH_ASSERT_ALWAYS(values.PtrOfCell(cell) != NULL);
+		}
+		return true;
+	}
+#endif
+};
+
+//end namespace
+}
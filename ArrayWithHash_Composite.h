@@ -0,0 +1,302 @@
+//          Copyright Stepan Gatilov 2016.
+// Distributed under the Boost Software License, Version 1.0.
+//      (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "ArrayWithHash.h"
+#include <vector>
+
+//namespace for ArrayWithHash
+namespace AWH_NAMESPACE {
+
+//two-level container for composite keys (hi, lo), e.g. (tenant, objectId)
+//High component selects a group: an ArrayWithHash keyed by low component.
+//Groups are stored (by pointer) in an outer ArrayWithHash keyed by high component.
+//If a key pair is packed into one big integer, it never gets into the array part,
+//while here dense low components of each group (and dense high components) do.
+//Empty groups are deleted immediately, so each group has at least one element.
+template<
+	class THi, class TLo, class TValue,
+#ifndef AWH_NO_CPP11
+	class THiTraits = DefaultKeyTraits<THi>, class TLoTraits = DefaultKeyTraits<TLo>,
+	class TValueTraits = DefaultValueTraits<TValue>
+#else
+	class THiTraits, class TLoTraits, class TValueTraits
+#endif
+>
+class CompositeArrayWithHash {
+public:
+	//accessing template arguments from outside
+	typedef THi Hi;
+	typedef TLo Lo;
+	typedef TValue Value;
+	typedef THiTraits HiTraits;
+	typedef TLoTraits LoTraits;
+	typedef TValueTraits ValueTraits;
+	//container for elements with same high component
+	typedef ArrayWithHash<Lo, Value, LoTraits, ValueTraits> Group;
+
+private:
+	//pointer to group is empty iff it is NULL
+	struct GroupPtrTraits {
+		static const bool RELOCATE_WITH_MEMCPY = true;
+		static AWH_INLINE bool IsEmpty(Group *group) {
+			return group == NULL;
+		}
+		static AWH_INLINE Group *GetEmpty() {
+			return NULL;
+		}
+	};
+	typedef ArrayWithHash<Hi, Group*, HiTraits, GroupPtrTraits> GroupMap;
+
+	//high component -> group of elements
+	GroupMap groups;
+	//total number of elements in all groups
+	size_t count;
+
+	//get group for given high component, creating it if necessary
+	AWH_INLINE Group *GetOrCreateGroup(Hi hi) {
+		Group **ptr = groups.GetPtr(hi);
+		if (ptr)
+			return *ptr;
+		Group *res = new Group();
+		groups.Set(hi, res);
+		return res;
+	}
+	//delete group if it has become empty
+	AWH_INLINE void DropIfEmpty(Hi hi, Group *group) {
+		if (group->GetSize() == 0) {
+			delete group;
+			groups.Remove(hi);
+		}
+	}
+
+	//deletes all groups
+	struct DeleteAction {
+		AWH_INLINE bool operator() (Hi, Group *&group) const {
+			delete group;
+			return false;
+		}
+	};
+	//adapter for iterating over all elements of all groups
+	//note: ArrayWithHash::ForEach does not report whether it was stopped, so flag is used
+	template<class Action> struct ElementAction {
+		Hi hi;
+		Action *action;
+		bool *stopped;
+		AWH_INLINE bool operator() (Lo lo, Value &value) const {
+			return *stopped = (*action)(hi, lo, value);
+		}
+	};
+	template<class Action> struct GroupAction {
+		Action *action;
+		bool *stopped;
+		AWH_INLINE bool operator() (Hi hi, Group *&group) const {
+			ElementAction<Action> adapter = {hi, action, stopped};
+			group->ForEach(adapter);
+			return *stopped;
+		}
+	};
+	//collects high components of groups into vector
+	struct CollectAction {
+		std::vector<Hi> *keys;
+		AWH_INLINE bool operator() (Hi hi, Group *&) const {
+			keys->push_back(hi);
+			return false;
+		}
+	};
+	//returns high components of all groups (to modify groups outside of ForEach)
+	AWH_NOINLINE std::vector<Hi> GroupKeys(const GroupMap &map) const {
+		std::vector<Hi> res;
+		res.reserve(size_t(map.GetSize()));
+		CollectAction action = {&res};
+		map.ForEach(action);
+		return res;
+	}
+
+	//note: CompositeArrayWithHash is non-copyable (just like ArrayWithHash)
+	CompositeArrayWithHash (const CompositeArrayWithHash &iSource);
+	void operator= (const CompositeArrayWithHash &iSource);
+
+public:
+	CompositeArrayWithHash() : count(0) {}
+	AWH_NOINLINE ~CompositeArrayWithHash() {
+		DeleteAction action;
+		groups.ForEach(action);
+	}
+
+	//fast O(1) swap of this object and another one
+	void Swap(CompositeArrayWithHash &other) {
+		groups.Swap(other.groups);
+		std::swap(count, other.count);
+	}
+
+	//remove all elements from container (all groups are freed)
+	AWH_NOINLINE void Clear() {
+		DeleteAction action;
+		groups.ForEach(action);
+		groups.Clear();
+		count = 0;
+	}
+
+	//return total number of elements currently inside
+	AWH_INLINE size_t GetSize() const {
+		return count;
+	}
+	//return number of distinct high components (i.e. number of groups)
+	AWH_INLINE typename HiTraits::Size GetGroupsCount() const {
+		return groups.GetSize();
+	}
+	//return group of elements with given high component, or NULL if there are none
+	//it can be used for operations on the whole group (e.g. ForEach, ForEachSorted, ExportColumns)
+	AWH_INLINE const Group *GetGroup(Hi hi) const {
+		Group **ptr = groups.GetPtr(hi);
+		return ptr ? *ptr : NULL;
+	}
+
+	//return pointer to the value for a given key, or NULL if it is not present
+	AWH_INLINE Value *GetPtr(Hi hi, Lo lo) const {
+		Group **ptr = groups.GetPtr(hi);
+		return ptr ? (*ptr)->GetPtr(lo) : NULL;
+	}
+	//return value for a given key (empty value if it is not present)
+	AWH_INLINE Value Get(Hi hi, Lo lo) const {
+		Value *ptr = GetPtr(hi, lo);
+		return ptr ? *ptr : ValueTraits::GetEmpty();
+	}
+
+	//set value for a given key, returns pointer to the value inside
+	AWH_INLINE Value *Set(Hi hi, Lo lo, Value value) {
+		Group *group = GetOrCreateGroup(hi);
+		size_t oldSize = size_t(group->GetSize());
+		Value *res = group->Set(lo, AWH_MOVE(value));
+		count += size_t(group->GetSize()) - oldSize;
+		return res;
+	}
+	//if key is present, then returns pointer to it
+	//otherwise inserts a new key with associated value, and returns NULL
+	AWH_INLINE Value *SetIfNew(Hi hi, Lo lo, Value value) {
+		Group *group = GetOrCreateGroup(hi);
+		size_t oldSize = size_t(group->GetSize());
+		Value *res = group->SetIfNew(lo, AWH_MOVE(value));
+		count += size_t(group->GetSize()) - oldSize;
+		return res;
+	}
+
+	//remove element with given key (if present)
+	AWH_INLINE void Remove(Hi hi, Lo lo) {
+		Group **ptr = groups.GetPtr(hi);
+		if (!ptr)
+			return;
+		Group *group = *ptr;
+		size_t oldSize = size_t(group->GetSize());
+		group->Remove(lo);
+		count -= oldSize - size_t(group->GetSize());
+		DropIfEmpty(hi, group);
+	}
+	//remove all elements with given high component
+	//returns number of removed elements
+	AWH_INLINE size_t RemoveGroup(Hi hi) {
+		Group **ptr = groups.GetPtr(hi);
+		if (!ptr)
+			return 0;
+		size_t removed = size_t((*ptr)->GetSize());
+		delete *ptr;
+		groups.RemovePtr(ptr);
+		count -= removed;
+		return removed;
+	}
+
+	//insert copies of all elements of other container with keys not present in this one
+	//groups missing in this container are cloned, common groups are united
+	//see ArrayWithHash::UniteWith for details
+	AWH_NOINLINE void UniteWith(const CompositeArrayWithHash &other) {
+		std::vector<Hi> keys = GroupKeys(other.groups);
+		for (size_t i = 0; i < keys.size(); i++) {
+			const Group *source = other.GetGroup(keys[i]);
+			Group *group = GetOrCreateGroup(keys[i]);
+			size_t oldSize = size_t(group->GetSize());
+			if (oldSize == 0)
+				source->CloneTo(*group);
+			else
+				group->UniteWith(*source);
+			count += size_t(group->GetSize()) - oldSize;
+		}
+	}
+	//remove all elements with keys not present in other container
+	AWH_NOINLINE void IntersectWith(const CompositeArrayWithHash &other) {
+		std::vector<Hi> keys = GroupKeys(groups);
+		for (size_t i = 0; i < keys.size(); i++) {
+			const Group *source = other.GetGroup(keys[i]);
+			if (!source) {
+				RemoveGroup(keys[i]);
+				continue;
+			}
+			Group *group = *groups.GetPtr(keys[i]);
+			size_t oldSize = size_t(group->GetSize());
+			group->IntersectWith(*source);
+			count -= oldSize - size_t(group->GetSize());
+			DropIfEmpty(keys[i], group);
+		}
+	}
+	//remove all elements with keys present in other container
+	AWH_NOINLINE void Subtract(const CompositeArrayWithHash &other) {
+		std::vector<Hi> keys = GroupKeys(other.groups);
+		for (size_t i = 0; i < keys.size(); i++) {
+			Group **ptr = groups.GetPtr(keys[i]);
+			if (!ptr)
+				continue;
+			Group *group = *ptr;
+			size_t oldSize = size_t(group->GetSize());
+			group->Subtract(*other.GetGroup(keys[i]));
+			count -= oldSize - size_t(group->GetSize());
+			DropIfEmpty(keys[i], group);
+		}
+	}
+	//check whether both containers have the same set of keys with equal values
+	//note: Value must be comparable with operator ==
+	AWH_NOINLINE bool Equals(const CompositeArrayWithHash &other) const {
+		if (count != other.count || groups.GetSize() != other.groups.GetSize())
+			return false;
+		std::vector<Hi> keys = GroupKeys(groups);
+		for (size_t i = 0; i < keys.size(); i++) {
+			const Group *source = other.GetGroup(keys[i]);
+			if (!source || !GetGroup(keys[i])->Equals(*source))
+				return false;
+		}
+		return true;
+	}
+
+	//perform given action for all the elements in this container
+	//elements of each group are visited consecutively
+	//callback is specified as a functor with signature:
+	//  bool action(Hi hi, Lo lo, Value &value);
+	//it must return: false to continue iteration, true to stop it
+	template<class Action> void ForEach(Action &action) const {
+		bool stopped = false;
+		GroupAction<Action> adapter = {&action, &stopped};
+		groups.ForEach(adapter);
+	}
+
+#ifdef AWH_TESTING
+	//internal method: checks all the invariants of the container
+	AWH_NOINLINE bool AssertCorrectness(int verbosity = 2) const {
+		groups.AssertCorrectness(verbosity);
+		std::vector<Hi> keys = GroupKeys(groups);
+		size_t total = 0;
+		for (size_t i = 0; i < keys.size(); i++) {
+			const Group *group = GetGroup(keys[i]);
+			AWH_ASSERT_ALWAYS(group && group->GetSize() > 0);
+			group->AssertCorrectness(verbosity);
+			total += size_t(group->GetSize());
+		}
+		AWH_ASSERT_ALWAYS(total == count);
+		return true;
+	}
+#endif
+};
+
+//end namespace
+}
@@ -0,0 +1,131 @@
+//          Copyright Stepan Gatilov 2016.
+// Distributed under the Boost Software License, Version 1.0.
+//      (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "ArrayWithHash.h"
+
+//C++20 coroutines are required
+#if !defined(__cpp_impl_coroutine) || __cpp_impl_coroutine < 201902L
+	#error ArrayWithHash_Coro.h requires C++20 compiler with coroutines support
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <vector>
+
+//namespace for ArrayWithHash
+namespace AWH_NAMESPACE {
+
+//coroutine type for lookups interleaved by RunInterleaved
+//coroutine must return nothing: results should be written by the coroutine itself
+//coroutine is created suspended, it is resumed and destroyed by the scheduler only
+class LookupTask {
+public:
+	struct promise_type {
+		AWH_INLINE LookupTask get_return_object() {
+			return LookupTask(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+		AWH_INLINE std::suspend_always initial_suspend() noexcept { return {}; }
+		AWH_INLINE std::suspend_always final_suspend() noexcept { return {}; }
+		AWH_INLINE void return_void() {}
+		//note: exceptions are not supported in lookup coroutines
+		void unhandled_exception() { std::terminate(); }
+	};
+
+private:
+	std::coroutine_handle<promise_type> handle;
+
+	AWH_INLINE explicit LookupTask(std::coroutine_handle<promise_type> h) : handle(h) {}
+	//note: LookupTask is movable but non-copyable
+	LookupTask(const LookupTask &iSource);
+	void operator= (const LookupTask &iSource);
+
+public:
+	AWH_INLINE LookupTask() : handle(nullptr) {}
+	AWH_INLINE LookupTask(LookupTask &&iSource) : handle(iSource.handle) {
+		iSource.handle = nullptr;
+	}
+	AWH_INLINE LookupTask &operator= (LookupTask &&iSource) {
+		std::swap(handle, iSource.handle);
+		return *this;
+	}
+	AWH_INLINE ~LookupTask() {
+		if (handle)
+			handle.destroy();
+	}
+
+	//check whether coroutine has finished (or is missing)
+	AWH_INLINE bool Done() const {
+		return !handle || handle.done();
+	}
+	//run coroutine until its next suspension point
+	AWH_INLINE void Resume() {
+		assert(!Done());
+		handle.resume();
+	}
+};
+
+//awaitable lookup in a container (see AsyncGetPtr)
+//memory is prefetched when coroutine suspends, lookup is done when it is resumed
+template<class Container> struct LookupAwaiter {
+	const Container *container;
+	typename Container::Key key;
+
+	AWH_INLINE bool await_ready() const noexcept { return false; }
+	AWH_INLINE void await_suspend(std::coroutine_handle<>) const noexcept {
+		container->Prefetch(key);
+	}
+	AWH_INLINE typename Container::Value *await_resume() const {
+		return container->GetPtr(key);
+	}
+};
+
+//awaitable version of container.GetPtr(key): to be used with co_await inside LookupTask
+//coroutine is suspended after prefetch is issued, so that other lookups can proceed meanwhile
+template<class Container> AWH_INLINE LookupAwaiter<Container> AsyncGetPtr(const Container &container, typename Container::Key key) {
+	LookupAwaiter<Container> res = {&container, key};
+	return res;
+}
+
+//run count lookup coroutines, keeping at most inflight of them started but not finished
+//coroutines are resumed in round-robin fashion, so that while one of them waits for memory,
+//the others are doing their work; i-th coroutine is obtained by calling factory(i)
+//Usage example (following chains of keys):
+//  auto chase = [&](size_t i) -> LookupTask {
+//    Key key = starts[i];
+//    while (const Key *next = co_await AsyncGetPtr(links, key))
+//      key = *next;
+//    ends[i] = key;
+//  };
+//  RunInterleaved(starts.size(), chase);
+//note: factory must outlive all the coroutines (i.e. don't pass a temporary lambda with captures)
+template<class Factory> AWH_NOINLINE void RunInterleaved(size_t count, Factory &factory, size_t inflight = PREFETCH_DISTANCE) {
+	assert(inflight > 0);
+	std::vector<LookupTask> tasks(std::min(count, inflight));
+	size_t started = 0;
+	for (size_t j = 0; j < tasks.size(); j++)
+		tasks[j] = factory(started++);
+	size_t alive = tasks.size();
+	while (alive > 0) {
+		for (size_t j = 0; j < tasks.size(); j++) {
+			if (tasks[j].Done())
+				continue;
+			tasks[j].Resume();
+			if (tasks[j].Done()) {
+				//replace finished coroutine with a new one (if any)
+				if (started < count)
+					tasks[j] = factory(started++);
+				else {
+					tasks[j] = LookupTask();
+					alive--;
+				}
+			}
+		}
+	}
+}
+
+//end namespace
+}
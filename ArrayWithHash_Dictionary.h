@@ -0,0 +1,311 @@
+//          Copyright Stepan Gatilov 2016.
+// Distributed under the Boost Software License, Version 1.0.
+//      (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "ArrayWithHash.h"
+#include <vector>
+#ifndef AWH_NO_CPP11
+#include <unordered_map>
+#else
+#include <map>
+#endif
+
+//namespace for ArrayWithHash
+namespace AWH_NAMESPACE {
+
+//traits of small integer codes stored inside DictionaryArrayWithHash
+//maximal representable code is reserved as EMPTY
+template<class Code> struct DictionaryCodeTraits {
+	static AWH_INLINE bool IsEmpty(const Code &code) {
+		return code == Code(-1);
+	}
+	static AWH_INLINE Code GetEmpty() {
+		return Code(-1);
+	}
+	static const bool RELOCATE_WITH_MEMCPY = true;
+};
+
+//array with hash table, which stores each distinct value only once
+//Container is intended for maps with low-cardinality values (enum-like strings, shared pointers).
+//Each distinct value is kept in a side table (dictionary), and its index (code) is stored in the map.
+//Code type must be an unsigned integer: uint8_t or uint16_t is advised.
+//Each code has a reference counter (number of elements with this code).
+//When it drops to zero, the code is freed and reused for some other value later.
+//So Set fails (returns NULL) only if all codes are used by the elements currently inside.
+//Value type must be copyable and hashable (or comparable in C++03 mode).
+template<
+	class TKey, class TValue,
+#ifndef AWH_NO_CPP11
+	class TCode = uint16_t,
+	class TKeyTraits = DefaultKeyTraits<TKey>, class TValueTraits = DefaultValueTraits<TValue>
+#else
+	class TCode, class TKeyTraits, class TValueTraits
+#endif
+>
+class DictionaryArrayWithHash {
+public:
+	//accessing template arguments from outside
+	typedef TKey Key;
+	typedef TValue Value;
+	typedef TCode Code;
+	typedef TKeyTraits KeyTraits;
+	typedef TValueTraits ValueTraits;
+	typedef DictionaryCodeTraits<Code> CodeTraits;
+	//default unsigned integer type
+	typedef typename KeyTraits::Size Size;
+	//underlying container with codes
+	typedef ArrayWithHash<Key, Code, KeyTraits, CodeTraits> CodeMap;
+
+	//special code: denotes missing element (or missing value in dictionary)
+	static const Code EMPTY_CODE = Code(-1);
+
+private:
+	//use unordered map if available, tree-based map otherwise
+#ifndef AWH_NO_CPP11
+	typedef std::unordered_map<Value, Code> ReverseIndex;
+#else
+	typedef std::map<Value, Code> ReverseIndex;
+#endif
+
+	//key -> code of value
+	CodeMap codes;
+	//code -> value (i.e. dictionary itself), free codes have EMPTY values
+	std::vector<Value> dictionary;
+	//code -> number of elements with this code
+	std::vector<Size> refCounts;
+	//codes which can be assigned to new values
+	std::vector<Code> freeCodes;
+	//value -> code (used on insertion only)
+	ReverseIndex reverse;
+	//returned by reference for missing elements
+	Value emptyValue;
+
+	//adapter for iterating over values instead of codes
+	template<class Action> struct DecodeAction {
+		const Value *dict;
+		Action *action;
+		AWH_INLINE bool operator() (Key key, Code &code) const {
+			return (*action)(key, dict[code]);
+		}
+	};
+
+	//remove value from dictionary, so that its code can be reused
+	AWH_NOINLINE void FreeCode(Code code) {
+		assert(refCounts[code] == 0);
+		reverse.erase(dictionary[code]);
+		dictionary[code] = ValueTraits::GetEmpty();
+		freeCodes.push_back(code);
+	}
+	//decrement reference counter of code, freeing it if it is no longer used
+	AWH_INLINE void Release(Code code) {
+		assert(refCounts[code] > 0);
+		if (--refCounts[code] == 0)
+			FreeCode(code);
+	}
+	//return code which is not assigned to any value, or EMPTY_CODE if all codes are used
+	AWH_NOINLINE Code AllocateCode() {
+		if (freeCodes.empty()) {
+			if (dictionary.size() < size_t(EMPTY_CODE)) {
+				dictionary.push_back(ValueTraits::GetEmpty());
+				refCounts.push_back(0);
+				return Code(dictionary.size() - 1);
+			}
+			//all codes are taken: free values which were encoded but never used
+			for (size_t i = 0; i < dictionary.size(); i++)
+				if (refCounts[i] == 0 && !ValueTraits::IsEmpty(dictionary[i]))
+					FreeCode(Code(i));
+			if (freeCodes.empty())
+				return EMPTY_CODE;
+		}
+		Code code = freeCodes.back();
+		freeCodes.pop_back();
+		return code;
+	}
+	//set code of element with given key, updating reference counters
+	AWH_INLINE void AssignCode(Key key, Code code) {
+		refCounts[code]++;
+		Code *ptr = codes.GetPtr(key);
+		if (ptr) {
+			Code old = *ptr;
+			*ptr = code;
+			Release(old);
+		}
+		else
+			codes.Set(key, code);
+	}
+
+#ifdef AWH_TESTING
+	//counts elements with each code (see AssertCorrectness)
+	struct CountAction {
+		std::vector<Size> *counts;
+		bool operator() (Key, Code &code) const {
+			(*counts)[code]++;
+			return false;
+		}
+	};
+#endif
+
+	//note: DictionaryArrayWithHash is non-copyable (just like ArrayWithHash)
+	DictionaryArrayWithHash (const DictionaryArrayWithHash &iSource);
+	void operator= (const DictionaryArrayWithHash &iSource);
+
+public:
+	DictionaryArrayWithHash() : emptyValue(ValueTraits::GetEmpty()) {}
+
+	//fast O(1) swap of this object and another one
+	void Swap(DictionaryArrayWithHash &other) {
+		codes.Swap(other.codes);
+		dictionary.swap(other.dictionary);
+		refCounts.swap(other.refCounts);
+		freeCodes.swap(other.freeCodes);
+		reverse.swap(other.reverse);
+	}
+
+	//remove all elements from container without shrinking
+	//note: dictionary is cleared too, so all codes become invalid
+	void Clear() {
+		codes.Clear();
+		dictionary.clear();
+		refCounts.clear();
+		freeCodes.clear();
+		reverse.clear();
+	}
+
+	//return number of elements currently inside
+	AWH_INLINE Size GetSize() const {
+		return codes.GetSize();
+	}
+	//return number of distinct values in the dictionary
+	AWH_INLINE Size GetDictionarySize() const {
+		return Size(reverse.size());
+	}
+
+	//return code of the value for given key, or EMPTY_CODE if the key is not present
+	//equal codes mean equal values, so codes can be compared instead of values
+	AWH_INLINE Code GetCode(Key key) const {
+		return codes.Get(key);
+	}
+	//return value for a given code (code must be valid)
+	AWH_INLINE const Value &Decode(Code code) const {
+		assert(Size(code) < Size(dictionary.size()) && !ValueTraits::IsEmpty(dictionary[code]));
+		return dictionary[code];
+	}
+	//return code of given value, or EMPTY_CODE if it is not in dictionary yet
+	Code FindCode(const Value &value) const {
+		typename ReverseIndex::const_iterator it = reverse.find(value);
+		return it == reverse.end() ? EMPTY_CODE : it->second;
+	}
+	//return code of given value, adding it to dictionary if necessary
+	//returns EMPTY_CODE if value is new and all codes are used by elements
+	//note: code which is not used by any element can be freed by the next Encode of a new value
+	AWH_NOINLINE Code Encode(const Value &value) {
+		assert(!ValueTraits::IsEmpty(value));
+		typename ReverseIndex::const_iterator it = reverse.find(value);
+		if (it != reverse.end())
+			return it->second;
+		Code code = AllocateCode();
+		if (code == EMPTY_CODE)
+			return EMPTY_CODE;
+		dictionary[code] = value;
+		reverse.insert(std::make_pair(value, code));
+		return code;
+	}
+
+	//return value for given key, or EMPTY value if the key is not present
+	//note: unlike ArrayWithHash::Get, no copy is made
+	AWH_INLINE const Value &Get(Key key) const {
+		Code code = codes.Get(key);
+		return code == EMPTY_CODE ? emptyValue : dictionary[code];
+	}
+	//return pointer to the value for a given key, or NULL if key is not present
+	//note: pointed value is shared among all keys with the same value
+	AWH_INLINE const Value *GetPtr(Key key) const {
+		Code code = codes.Get(key);
+		return code == EMPTY_CODE ? NULL : &dictionary[code];
+	}
+
+	//set the code associated with the given key (code must be valid)
+	AWH_INLINE void SetCode(Key key, Code code) {
+		assert(Size(code) < Size(dictionary.size()) && !ValueTraits::IsEmpty(dictionary[code]));
+		AssignCode(key, code);
+	}
+	//set the value associated with the given key
+	//returns pointer to the dictionary entry, or NULL if value is new and
+	//all codes are used by elements (see Encode), in which case container is not modified
+	const Value *Set(Key key, const Value &value) {
+		Code code = Encode(value);
+		if (code == EMPTY_CODE)
+			return NULL;
+		AssignCode(key, code);
+		return &dictionary[code];
+	}
+
+	//remove element with the given key (if present)
+	//if it was the last element with its value, then the value is removed from dictionary
+	AWH_INLINE void Remove(Key key) {
+		Code *ptr = codes.GetPtr(key);
+		if (!ptr)
+			return;
+		Code code = *ptr;
+		codes.RemovePtr(ptr);
+		Release(code);
+	}
+
+	//force to reserve some memory for both array and hash table parts
+	//see ArrayWithHash::Reserve for details
+	void Reserve(Size arraySizeLB, Size hashSizeLB, bool alwaysCleanHash = false) {
+		codes.Reserve(arraySizeLB, hashSizeLB, alwaysCleanHash);
+	}
+
+	//read-only access to codes of all elements
+	//useful for fast scans: comparing codes is cheaper than comparing values
+	AWH_INLINE const CodeMap &GetCodes() const {
+		return codes;
+	}
+
+	//perform given action for all the elements in this container
+	//callback is specified as a functor with signature:
+	//  bool action(Key key, const Value &value);
+	//it must return: false to continue iteration, true to stop it
+	template<class Action> void ForEach(Action &action) const {
+		DecodeAction<Action> decoder;
+		decoder.dict = dictionary.empty() ? NULL : &dictionary[0];
+		decoder.action = &action;
+		codes.ForEach(decoder);
+	}
+
+#ifdef AWH_TESTING
+	//internal method: checks all the invariants of the container
+	AWH_NOINLINE bool AssertCorrectness(int verbosity = 2) const {
+		codes.AssertCorrectness(verbosity);
+		AWH_ASSERT_ALWAYS(dictionary.size() == reverse.size() + freeCodes.size());
+		AWH_ASSERT_ALWAYS(dictionary.size() == refCounts.size());
+		AWH_ASSERT_ALWAYS(dictionary.size() <= size_t(EMPTY_CODE));
+		if (verbosity >= 1) {
+			//reference counters must be exact
+			std::vector<Size> counts(dictionary.size(), 0);
+			CountAction action = {&counts};
+			codes.ForEach(action);
+			AWH_ASSERT_ALWAYS(counts == refCounts);
+			//dictionary and reverse index must be consistent, free codes have no values
+			for (size_t i = 0; i < dictionary.size(); i++) {
+				if (ValueTraits::IsEmpty(dictionary[i])) {
+					AWH_ASSERT_ALWAYS(refCounts[i] == 0);
+				}
+				else {
+					AWH_ASSERT_ALWAYS(FindCode(dictionary[i]) == Code(i));
+				}
+			}
+			for (size_t i = 0; i < freeCodes.size(); i++)
+				AWH_ASSERT_ALWAYS(ValueTraits::IsEmpty(dictionary[freeCodes[i]]));
+		}
+		return true;
+	}
+#endif
+};
+
+//end namespace
+}
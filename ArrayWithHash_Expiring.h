@@ -0,0 +1,348 @@
+//          Copyright Stepan Gatilov 2016.
+// Distributed under the Boost Software License, Version 1.0.
+//      (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "ArrayWithHash.h"
+
+//namespace for ArrayWithHash
+namespace AWH_NAMESPACE {
+
+//array with hash table, where each element has time-to-live (TTL)
+//Time is measured in abstract integer ticks, and it is moved forward by Advance.
+//Elements are scheduled in a hierarchical timing wheel by their expiry tick:
+//each level has 64 slots, and each slot is an intrusive doubly-linked list of keys.
+//Advance removes all expired elements, and its cost is proportional to the number of
+//removed elements (plus O(1) amortized per element for moving it to lower level),
+//so it does not depend on number of elements in container or on the number of ticks passed.
+template<
+	class TKey, class TValue,
+#ifndef AWH_NO_CPP11
+	class TKeyTraits = DefaultKeyTraits<TKey>, class TValueTraits = DefaultValueTraits<TValue>
+#else
+	class TKeyTraits, class TValueTraits
+#endif
+>
+class ExpiringArrayWithHash {
+public:
+	//accessing template arguments from outside
+	typedef TKey Key;
+	typedef TValue Value;
+	typedef TKeyTraits KeyTraits;
+	typedef TValueTraits ValueTraits;
+	//default unsigned integer type
+	typedef typename KeyTraits::Size Size;
+	//type of time moments (in ticks)
+	typedef uint64_t Time;
+
+	//number of bits of expiry tick handled by one level of timing wheel
+	static const int LEVEL_BITS = 6;
+	//number of slots in each level
+	static const int LEVEL_SLOTS = 1 << LEVEL_BITS;
+	//number of levels: enough to cover all 64 bits of time
+	static const int LEVELS = (64 + LEVEL_BITS - 1) / LEVEL_BITS;
+
+private:
+	//special key: denotes end of intrusive list
+	static const Key NO_KEY = KeyTraits::EMPTY_KEY;
+
+	//value stored in container together with its scheduling data
+	struct Entry {
+		Value value;
+		//element is removed when time reaches this moment
+		Time expiry;
+		//neighbors in the list of timing wheel slot
+		Key prev, next;
+	};
+	//entry is empty iff its value is empty
+	struct EntryTraits {
+		static const bool RELOCATE_WITH_MEMCPY = ValueTraits::RELOCATE_WITH_MEMCPY;
+		static AWH_INLINE bool IsEmpty(const Entry &entry) {
+			return ValueTraits::IsEmpty(entry.value);
+		}
+		static AWH_INLINE Entry GetEmpty() {
+			Entry res;
+			res.value = ValueTraits::GetEmpty();
+			res.expiry = 0;
+			res.prev = res.next = NO_KEY;
+			return res;
+		}
+	};
+	typedef ArrayWithHash<Key, Entry, KeyTraits, EntryTraits> EntryMap;
+
+	//all the elements: key -> entry
+	EntryMap entries;
+	//current time: all the elements with expiry <= now are already removed
+	//note: except for elements set with zero TTL, they are removed by next Advance
+	Time now;
+	//first key in list for each slot of timing wheel (NO_KEY if list is empty)
+	Key heads[LEVELS][LEVEL_SLOTS];
+	//bitmask of nonempty slots for each level
+	uint64_t occupied[LEVELS];
+
+	//get level and slot where element with given expiry must be
+	//level is determined by the highest bit where expiry differs from current time
+	AWH_INLINE void Locate(Time expiry, int &level, int &slot) const {
+		Time diff = expiry ^ now;
+		level = diff ? int(log2size(diff) - 1) / LEVEL_BITS : 0;
+		slot = int(expiry >> (level * LEVEL_BITS)) & (LEVEL_SLOTS - 1);
+	}
+
+	//insert element into the list of its slot
+	AWH_INLINE void Link(Key key, Entry &entry) {
+		int level, slot;
+		Locate(entry.expiry, level, slot);
+		Key &head = heads[level][slot];
+		entry.prev = NO_KEY;
+		entry.next = head;
+		if (head != NO_KEY)
+			entries.GetPtr(head)->prev = key;
+		head = key;
+		occupied[level] |= uint64_t(1) << slot;
+	}
+	//remove element from the list of its slot
+	AWH_INLINE void Unlink(Entry &entry) {
+		if (entry.next != NO_KEY)
+			entries.GetPtr(entry.next)->prev = entry.prev;
+		if (entry.prev != NO_KEY)
+			entries.GetPtr(entry.prev)->next = entry.next;
+		else {
+			int level, slot;
+			Locate(entry.expiry, level, slot);
+			heads[level][slot] = entry.next;
+			if (entry.next == NO_KEY)
+				occupied[level] &= ~(uint64_t(1) << slot);
+		}
+	}
+
+	//detach the whole list of given slot, returns its first key
+	AWH_INLINE Key TakeSlot(int level, int slot) {
+		Key head = heads[level][slot];
+		heads[level][slot] = NO_KEY;
+		occupied[level] &= ~(uint64_t(1) << slot);
+		return head;
+	}
+	//remove all the elements in a detached list, returns their number
+	AWH_NOINLINE Size RemoveList(Key key) {
+		Size cnt = 0;
+		while (key != NO_KEY) {
+			Entry *entry = entries.GetPtr(key);
+			key = entry->next;
+			entries.RemovePtr(entry);
+			cnt++;
+		}
+		return cnt;
+	}
+	//move all the elements in a detached list to lower levels (according to current time)
+	AWH_NOINLINE void Cascade(Key key) {
+		while (key != NO_KEY) {
+			Entry *entry = entries.GetPtr(key);
+			Key next = entry->next;
+			Link(key, *entry);
+			key = next;
+		}
+	}
+
+	//reset timing wheel to empty state
+	AWH_INLINE void ClearWheel() {
+		for (int l = 0; l < LEVELS; l++) {
+			for (int s = 0; s < LEVEL_SLOTS; s++)
+				heads[l][s] = NO_KEY;
+			occupied[l] = 0;
+		}
+	}
+
+	//adapter for iterating over values instead of entries
+	template<class Action> struct ValueAction {
+		Action *action;
+		AWH_INLINE bool operator() (Key key, Entry &entry) const {
+			return (*action)(key, entry.value);
+		}
+	};
+
+	//note: ExpiringArrayWithHash is non-copyable (just like ArrayWithHash)
+	ExpiringArrayWithHash (const ExpiringArrayWithHash &iSource);
+	void operator= (const ExpiringArrayWithHash &iSource);
+
+public:
+	//create empty container with given current time
+	explicit ExpiringArrayWithHash(Time startTime = 0) : now(startTime) {
+		ClearWheel();
+	}
+
+	//swap of this object and another one
+	//note: timing wheel is stored inline, so it is swapped element-by-element
+	void Swap(ExpiringArrayWithHash &other) {
+		entries.Swap(other.entries);
+		std::swap(now, other.now);
+		for (int l = 0; l < LEVELS; l++) {
+			for (int s = 0; s < LEVEL_SLOTS; s++)
+				std::swap(heads[l][s], other.heads[l][s]);
+			std::swap(occupied[l], other.occupied[l]);
+		}
+	}
+
+	//remove all elements from container without shrinking (current time is not changed)
+	AWH_NOINLINE void Clear() {
+		entries.Clear();
+		ClearWheel();
+	}
+
+	//return number of elements currently inside
+	AWH_INLINE Size GetSize() const {
+		return entries.GetSize();
+	}
+	//return current time
+	AWH_INLINE Time GetTime() const {
+		return now;
+	}
+
+	//return pointer to the value for a given key, or NULL if it is not present
+	AWH_INLINE Value *GetPtr(Key key) const {
+		Entry *entry = entries.GetPtr(key);
+		return entry ? &entry->value : NULL;
+	}
+	//return value for a given key (empty value if it is not present)
+	AWH_INLINE Value Get(Key key) const {
+		Entry *entry = entries.GetPtr(key);
+		return entry ? entry->value : ValueTraits::GetEmpty();
+	}
+	//return moment when element with given key expires (key must be present)
+	AWH_INLINE Time GetExpiry(Key key) const {
+		Entry *entry = entries.GetPtr(key);
+		assert(entry);
+		return entry->expiry;
+	}
+
+	//set value for a given key, which expires after ttl ticks from now
+	//if the key is already present, then both its value and expiry are overwritten
+	//returns pointer to the value inside container
+	AWH_INLINE Value *Set(Key key, Value value, Time ttl) {
+		assert(!ValueTraits::IsEmpty(value));
+		assert(ttl <= Time(-1) - now);
+		Entry *entry = entries.GetPtr(key);
+		if (entry) {
+			Unlink(*entry);
+			entry->value = AWH_MOVE(value);
+		}
+		else {
+			Entry tmp;
+			tmp.value = AWH_MOVE(value);
+			entry = entries.Set(key, AWH_MOVE(tmp));
+		}
+		entry->expiry = now + ttl;
+		Link(key, *entry);
+		return &entry->value;
+	}
+
+	//change expiry of element with given key, so that it expires after ttl ticks from now
+	//returns false if key is not present (then nothing is changed)
+	AWH_INLINE bool SetTtl(Key key, Time ttl) {
+		assert(ttl <= Time(-1) - now);
+		Entry *entry = entries.GetPtr(key);
+		if (!entry)
+			return false;
+		Unlink(*entry);
+		entry->expiry = now + ttl;
+		Link(key, *entry);
+		return true;
+	}
+
+	//remove element with given key (if present)
+	AWH_INLINE void Remove(Key key) {
+		Entry *entry = entries.GetPtr(key);
+		if (!entry)
+			return;
+		Unlink(*entry);
+		entries.RemovePtr(entry);
+	}
+
+	//move current time forward to the given moment
+	//all the elements with expiry <= newTime are removed, returns their number
+	//expired elements are removed slot by slot: each slot list is dropped at once
+	AWH_NOINLINE Size Advance(Time newTime) {
+		assert(newTime >= now);
+		Size removed = 0;
+		while (1) {
+			//expire elements in level 0 up to the end of current block of ticks
+			Time blockEnd = now | Time(LEVEL_SLOTS - 1);
+			int first = int(now & (LEVEL_SLOTS - 1));
+			int last = int(std::min(newTime, blockEnd) & (LEVEL_SLOTS - 1));
+			uint64_t mask = occupied[0] & ((uint64_t(2) << last) - 1) & ~((uint64_t(1) << first) - 1);
+			for (; mask; mask &= mask - 1)
+				removed += RemoveList(TakeSlot(0, int(ctz(mask))));
+			if (newTime <= blockEnd) {
+				now = newTime;
+				return removed;
+			}
+			//level 0 is empty now: find the next nonempty slot on the lowest nonempty level
+			//note: all nonempty slots of a level are after current time on this level
+			int level = 1;
+			while (level < LEVELS && !occupied[level])
+				level++;
+			if (level == LEVELS) {
+				now = newTime;
+				return removed;
+			}
+			int slot = int(ctz(occupied[level]));
+			int shift = level * LEVEL_BITS;
+			Time upperMask = (shift + LEVEL_BITS >= 64 ? 0 : Time(-1) << (shift + LEVEL_BITS));
+			Time slotStart = (now & upperMask) | (Time(slot) << shift);
+			if (slotStart > newTime) {
+				//no element expires until newTime, and no element has to be moved
+				now = newTime;
+				return removed;
+			}
+			//jump to the beginning of the slot and move its elements to lower levels
+			now = slotStart;
+			Cascade(TakeSlot(level, slot));
+		}
+	}
+
+	//perform given action for all the elements in this container
+	//callback is specified as a functor with signature:
+	//  bool action(Key key, Value &value);
+	//it must return: false to continue iteration, true to stop it
+	template<class Action> void ForEach(Action &action) const {
+		ValueAction<Action> adapter;
+		adapter.action = &action;
+		entries.ForEach(adapter);
+	}
+
+#ifdef AWH_TESTING
+	//internal method: checks all the invariants of the container
+	AWH_NOINLINE bool AssertCorrectness(int verbosity = 2) const {
+		entries.AssertCorrectness(verbosity);
+		if (verbosity >= 1) {
+			//each element is in the list of its slot, and lists contain nothing else
+			Size total = 0;
+			for (int l = 0; l < LEVELS; l++) {
+				for (int s = 0; s < LEVEL_SLOTS; s++) {
+					Key key = heads[l][s];
+					AWH_ASSERT_ALWAYS((key != NO_KEY) == bool(occupied[l] >> s & 1));
+					Key prev = NO_KEY;
+					for (; key != NO_KEY; key = entries.GetPtr(key)->next) {
+						const Entry *entry = entries.GetPtr(key);
+						AWH_ASSERT_ALWAYS(entry && entry->prev == prev);
+						int level, slot;
+						Locate(entry->expiry, level, slot);
+						AWH_ASSERT_ALWAYS(level == l && slot == s);
+						//elements on upper levels lie strictly after current time on their level
+						AWH_ASSERT_ALWAYS(l == 0 ? entry->expiry >= now : slot > int(now >> (l * LEVEL_BITS) & (LEVEL_SLOTS - 1)));
+						prev = key;
+						total++;
+						AWH_ASSERT_ALWAYS(total <= entries.GetSize());
+					}
+				}
+			}
+			AWH_ASSERT_ALWAYS(total == entries.GetSize());
+		}
+		return true;
+	}
+#endif
+};
+
+//end namespace
+}
@@ -0,0 +1,246 @@
+//          Copyright Stepan Gatilov 2016.
+// Distributed under the Boost Software License, Version 1.0.
+//      (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "ArrayWithHash.h"
+#include <vector>
+#include <string>
+
+//namespace for ArrayWithHash
+namespace AWH_NAMESPACE {
+
+//string interner: maps strings to dense integer IDs 0, 1, 2, ... (in order of first occurrence)
+//Containers keyed by these IDs never leave the array part of ArrayWithHash.
+//Characters of all strings are stored in arena: large chunks allocated one by one,
+//each string is kept there (with terminating zero) until Clear is called.
+//ID -> string lookup is done by ArrayWithHash (IDs are dense, so it is plain array access),
+//string -> ID lookup is done by open addressing hash table of IDs.
+//note: strings may contain zero characters (length is stored explicitly)
+template<
+#ifndef AWH_NO_CPP11
+	class TId = uint32_t, class TIdTraits = DefaultKeyTraits<TId>
+#else
+	class TId, class TIdTraits
+#endif
+>
+class StringInterner {
+public:
+	//accessing template arguments from outside
+	typedef TId Id;
+	typedef TIdTraits IdTraits;
+	//default unsigned integer type
+	typedef typename IdTraits::Size Size;
+
+	//special ID: returned by Find if string is not interned
+	static const Id NO_ID = IdTraits::EMPTY_KEY;
+	//size of arena chunk in bytes
+	//note: strings longer than quarter of chunk get separate chunks of their own
+	static const size_t CHUNK_SIZE = 1 << 16;
+
+private:
+	//interned string (points into arena)
+	struct Entry {
+		const char *data;
+		size_t length;
+		//hash of string: saved to avoid rehashing and most of string comparisons
+		size_t hash;
+	};
+	//entry is empty iff its data is NULL
+	struct EntryTraits {
+		static const bool RELOCATE_WITH_MEMCPY = true;
+		static AWH_INLINE bool IsEmpty(const Entry &entry) {
+			return entry.data == NULL;
+		}
+		static AWH_INLINE Entry GetEmpty() {
+			Entry res = {NULL, 0, 0};
+			return res;
+		}
+	};
+	typedef ArrayWithHash<Id, Entry, IdTraits, EntryTraits> EntryMap;
+
+	//ID -> string
+	EntryMap entries;
+	//string -> ID: hash table with linear probing (NO_ID in empty cells)
+	std::vector<Id> index;
+	//all chunks of arena (allocated with malloc)
+	std::vector<char*> chunks;
+	//free space in the last regular chunk
+	char *chunkPos;
+	size_t chunkLeft;
+
+	//FNV-1a hash of string
+	static AWH_INLINE size_t HashString(const char *str, size_t length) {
+		uint64_t res = 14695981039346656037ULL;
+		for (size_t i = 0; i < length; i++)
+			res = (res ^ uint8_t(str[i])) * 1099511628211ULL;
+		return size_t(res ^ (res >> 32));
+	}
+
+	//find cell of index with given string, or empty cell where it should be inserted
+	AWH_INLINE size_t FindCell(const char *str, size_t length, size_t hash) const {
+		size_t mask = index.size() - 1;
+		for (size_t cell = hash & mask; ; cell = (cell + 1) & mask) {
+			Id id = index[cell];
+			if (id == NO_ID)
+				return cell;
+			const Entry *entry = entries.GetPtr(id);
+			if (entry->hash == hash && entry->length == length && memcmp(entry->data, str, length) == 0)
+				return cell;
+		}
+	}
+
+	//double size of index and put all IDs into it again
+	AWH_NOINLINE void GrowIndex() {
+		size_t newSize = std::max(2 * index.size(), size_t(HASH_MIN_SIZE));
+		std::vector<Id> newIndex(newSize, Id(NO_ID));
+		Size cnt = entries.GetSize();
+		for (Size i = 0; i < cnt; i++) {
+			size_t cell = entries.GetPtr(Id(i))->hash & (newSize - 1);
+			while (newIndex[cell] != NO_ID)
+				cell = (cell + 1) & (newSize - 1);
+			newIndex[cell] = Id(i);
+		}
+		index.swap(newIndex);
+	}
+
+	//copy string into arena (with terminating zero), returns pointer to the copy
+	AWH_NOINLINE char *Store(const char *str, size_t length) {
+		size_t bytes = length + 1;
+		char *res;
+		if (bytes > CHUNK_SIZE / 4) {
+			//long string: separate chunk
+			res = (char*)malloc(bytes);
+			chunks.push_back(res);
+		}
+		else {
+			if (bytes > chunkLeft) {
+				chunkPos = (char*)malloc(CHUNK_SIZE);
+				chunkLeft = CHUNK_SIZE;
+				chunks.push_back(chunkPos);
+			}
+			res = chunkPos;
+			chunkPos += bytes;
+			chunkLeft -= bytes;
+		}
+		memcpy(res, str, length);
+		res[length] = 0;
+		return res;
+	}
+
+	//free all chunks of arena
+	AWH_INLINE void FreeChunks() {
+		for (size_t i = 0; i < chunks.size(); i++)
+			free(chunks[i]);
+		chunks.clear();
+		chunkPos = NULL;
+		chunkLeft = 0;
+	}
+
+	//note: StringInterner is non-copyable (just like ArrayWithHash)
+	StringInterner (const StringInterner &iSource);
+	void operator= (const StringInterner &iSource);
+
+public:
+	StringInterner() : chunkPos(NULL), chunkLeft(0) {}
+	AWH_NOINLINE ~StringInterner() {
+		FreeChunks();
+	}
+
+	//fast O(1) swap of this object and another one
+	void Swap(StringInterner &other) {
+		entries.Swap(other.entries);
+		index.swap(other.index);
+		chunks.swap(other.chunks);
+		std::swap(chunkPos, other.chunkPos);
+		std::swap(chunkLeft, other.chunkLeft);
+	}
+
+	//forget all strings (arena memory is freed), IDs are allocated from zero again
+	AWH_NOINLINE void Clear() {
+		entries.Clear();
+		std::fill(index.begin(), index.end(), Id(NO_ID));
+		FreeChunks();
+	}
+
+	//return number of interned strings (all IDs are less than this number)
+	AWH_INLINE Size GetSize() const {
+		return entries.GetSize();
+	}
+
+	//return ID of given string, or NO_ID if it was not interned yet
+	AWH_INLINE Id Find(const char *str, size_t length) const {
+		if (index.empty())
+			return NO_ID;
+		return index[FindCell(str, length, HashString(str, length))];
+	}
+	AWH_INLINE Id Find(const char *str) const {
+		return Find(str, strlen(str));
+	}
+	AWH_INLINE Id Find(const std::string &str) const {
+		return Find(str.data(), str.size());
+	}
+
+	//return ID of given string, assigning next ID to it if it was not interned yet
+	AWH_INLINE Id Intern(const char *str, size_t length) {
+		size_t hash = HashString(str, length);
+		if (IsHashFull(Size(entries.GetSize() + 1), Size(index.size())))
+			GrowIndex();
+		size_t cell = FindCell(str, length, hash);
+		if (index[cell] != NO_ID)
+			return index[cell];
+		Entry entry = {Store(str, length), length, hash};
+		Id id = entries.PushBack(entry);
+		assert(id != NO_ID && id != IdTraits::REMOVED_KEY);
+		index[cell] = id;
+		return id;
+	}
+	AWH_INLINE Id Intern(const char *str) {
+		return Intern(str, strlen(str));
+	}
+	AWH_INLINE Id Intern(const std::string &str) {
+		return Intern(str.data(), str.size());
+	}
+
+	//return interned string with given ID (zero-terminated), ID must be valid
+	AWH_INLINE const char *GetString(Id id) const {
+		assert(Size(id) < entries.GetSize());
+		return entries.GetPtr(id)->data;
+	}
+	//return length of interned string with given ID, ID must be valid
+	AWH_INLINE size_t GetLength(Id id) const {
+		assert(Size(id) < entries.GetSize());
+		return entries.GetPtr(id)->length;
+	}
+
+#ifdef AWH_TESTING
+	//internal method: checks all the invariants of the container
+	AWH_NOINLINE bool AssertCorrectness(int verbosity = 2) const {
+		entries.AssertCorrectness(verbosity);
+		//IDs are dense
+		for (Size i = 0; i < entries.GetSize(); i++)
+			AWH_ASSERT_ALWAYS(entries.GetPtr(Id(i)) != NULL);
+		if (verbosity >= 1) {
+			//each ID is present in index exactly once
+			Size cnt = 0;
+			for (size_t i = 0; i < index.size(); i++) {
+				Id id = index[i];
+				if (id == NO_ID)
+					continue;
+				const Entry *entry = entries.GetPtr(id);
+				AWH_ASSERT_ALWAYS(entry && entry->data[entry->length] == 0);
+				AWH_ASSERT_ALWAYS(entry->hash == HashString(entry->data, entry->length));
+				AWH_ASSERT_ALWAYS(FindCell(entry->data, entry->length, entry->hash) == i);
+				cnt++;
+			}
+			AWH_ASSERT_ALWAYS(cnt == entries.GetSize());
+		}
+		return true;
+	}
+#endif
+};
+
+//end namespace
+}
@@ -0,0 +1,296 @@
+//          Copyright Stepan Gatilov 2016.
+// Distributed under the Boost Software License, Version 1.0.
+//      (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "ArrayWithHash.h"
+#include <vector>
+
+//namespace for ArrayWithHash
+namespace AWH_NAMESPACE {
+
+//array with hash table, where each key has a list of values (i.e. multimap)
+//All values are stored in one shared arena (like in CSR format for sparse matrices):
+//each key maps to a run of consecutive cells in the arena, so values of a key are contiguous.
+//A run has spare capacity filled with empty values; when it is exhausted, the run is
+//moved to the end of arena with doubled capacity (unless it is at the end already).
+//Cells left behind are garbage: when garbage makes more than half of arena,
+//the arena is compacted, i.e. all runs are packed tightly into a new arena.
+//note: Value must be copyable or movable, empty values fill unused cells of arena
+template<
+	class TKey, class TValue,
+#ifndef AWH_NO_CPP11
+	class TKeyTraits = DefaultKeyTraits<TKey>, class TValueTraits = DefaultValueTraits<TValue>
+#else
+	class TKeyTraits, class TValueTraits
+#endif
+>
+class MultiArrayWithHash {
+public:
+	//accessing template arguments from outside
+	typedef TKey Key;
+	typedef TValue Value;
+	typedef TKeyTraits KeyTraits;
+	typedef TValueTraits ValueTraits;
+	//default unsigned integer type
+	typedef typename KeyTraits::Size Size;
+
+	//minimal capacity of a run allocated in arena
+	static const size_t RUN_MIN_CAPACITY = 4;
+	//minimal number of garbage cells for automatic compaction
+	static const size_t COMPACT_MIN_GARBAGE = 64;
+
+private:
+	//location of values for a key in arena
+	struct Run {
+		size_t offset;
+		size_t length;
+		size_t capacity;
+	};
+	//run with offset = -1 is empty
+	struct RunTraits {
+		static const bool RELOCATE_WITH_MEMCPY = true;
+		static AWH_INLINE bool IsEmpty(const Run &run) {
+			return run.offset == size_t(-1);
+		}
+		static AWH_INLINE Run GetEmpty() {
+			Run res = {size_t(-1), 0, 0};
+			return res;
+		}
+	};
+	typedef ArrayWithHash<Key, Run, KeyTraits, RunTraits> RunMap;
+
+	//key -> run of its values in arena
+	RunMap runs;
+	//all values (and unused cells with empty values)
+	std::vector<Value> arena;
+	//total number of values in all runs
+	size_t valuesCount;
+	//number of arena cells which do not belong to any run
+	size_t garbage;
+
+	//release cells of arena in the given range (they become garbage)
+	AWH_INLINE void Release(size_t offset, size_t count) {
+		for (size_t i = 0; i < count; i++)
+			arena[offset + i] = ValueTraits::GetEmpty();
+		garbage += count;
+	}
+
+	//move run to the end of arena with given capacity
+	AWH_NOINLINE void MoveToEnd(Run &run, size_t newCapacity) {
+		assert(newCapacity >= run.length);
+		size_t newOffset = arena.size();
+		//note: reserve in advance, so that moved values are not invalidated
+		if (arena.capacity() < newOffset + newCapacity)
+			arena.reserve(std::max(newOffset + newCapacity, 2 * arena.capacity()));
+		for (size_t i = 0; i < run.length; i++)
+			arena.push_back(AWH_MOVE(arena[run.offset + i]));
+		for (size_t i = run.length; i < newCapacity; i++)
+			arena.push_back(ValueTraits::GetEmpty());
+		Release(run.offset, run.capacity);
+		run.offset = newOffset;
+		run.capacity = newCapacity;
+	}
+
+	//packs runs into new arena tightly
+	struct CompactAction {
+		std::vector<Value> *oldArena, *newArena;
+		AWH_INLINE bool operator() (Key, Run &run) const {
+			size_t newOffset = newArena->size();
+			for (size_t i = 0; i < run.length; i++)
+				newArena->push_back(AWH_MOVE((*oldArena)[run.offset + i]));
+			run.offset = newOffset;
+			run.capacity = run.length;
+			return false;
+		}
+	};
+
+	//adapter for iterating over all (key, value) pairs
+	template<class Action> struct PairsAction {
+		std::vector<Value> *arena;
+		Action *action;
+		AWH_INLINE bool operator() (Key key, Run &run) const {
+			for (size_t i = 0; i < run.length; i++)
+				if ((*action)(key, (*arena)[run.offset + i]))
+					return true;
+			return false;
+		}
+	};
+
+#ifdef AWH_TESTING
+	//checks runs and marks their cells as used (see AssertCorrectness)
+	struct CheckAction {
+		const std::vector<Value> *arena;
+		std::vector<char> *used;
+		size_t *totalLength, *totalCapacity;
+		bool operator() (Key, Run &run) const {
+			AWH_ASSERT_ALWAYS(run.length > 0 && run.length <= run.capacity);
+			AWH_ASSERT_ALWAYS(run.offset + run.capacity <= arena->size());
+			for (size_t i = 0; i < run.capacity; i++) {
+				AWH_ASSERT_ALWAYS(!(*used)[run.offset + i]);
+				(*used)[run.offset + i] = 1;
+				AWH_ASSERT_ALWAYS(ValueTraits::IsEmpty((*arena)[run.offset + i]) == (i >= run.length));
+			}
+			*totalLength += run.length;
+			*totalCapacity += run.capacity;
+			return false;
+		}
+	};
+#endif
+
+	//note: MultiArrayWithHash is non-copyable (just like ArrayWithHash)
+	MultiArrayWithHash (const MultiArrayWithHash &iSource);
+	void operator= (const MultiArrayWithHash &iSource);
+
+public:
+	MultiArrayWithHash() : valuesCount(0), garbage(0) {}
+
+	//fast O(1) swap of this object and another one
+	void Swap(MultiArrayWithHash &other) {
+		runs.Swap(other.runs);
+		arena.swap(other.arena);
+		std::swap(valuesCount, other.valuesCount);
+		std::swap(garbage, other.garbage);
+	}
+
+	//remove all elements from container without shrinking arena memory
+	AWH_NOINLINE void Clear() {
+		runs.Clear();
+		arena.clear();
+		valuesCount = 0;
+		garbage = 0;
+	}
+
+	//return number of keys with at least one value
+	AWH_INLINE Size GetKeysCount() const {
+		return runs.GetSize();
+	}
+	//return total number of values for all keys
+	AWH_INLINE size_t GetSize() const {
+		return valuesCount;
+	}
+	//return number of cells in arena (including spare and garbage ones)
+	AWH_INLINE size_t GetArenaSize() const {
+		return arena.size();
+	}
+
+	//return number of values for a given key
+	AWH_INLINE size_t GetCount(Key key) const {
+		Run *run = runs.GetPtr(key);
+		return run ? run->length : 0;
+	}
+	//return pointer to contiguous array of values for a given key, writes their number to count
+	//returns NULL if key has no values
+	//note: pointer is invalidated by Append, RemoveKey and CompactArena
+	AWH_INLINE Value *GetValues(Key key, size_t &count) const {
+		Run *run = runs.GetPtr(key);
+		if (!run) {
+			count = 0;
+			return NULL;
+		}
+		count = run->length;
+		return const_cast<Value*>(&arena[run->offset]);
+	}
+
+	//add value to the end of list of values for a given key
+	//returns pointer to the value inside arena
+	AWH_INLINE Value *Append(Key key, Value value) {
+		assert(!ValueTraits::IsEmpty(value));
+		Run *run = runs.GetPtr(key);
+		if (!run) {
+			Run empty = {arena.size(), 0, 0};
+			run = runs.Set(key, empty);
+		}
+		if (run->length == run->capacity) {
+			bool atEnd = (run->offset + run->capacity == arena.size());
+			if (!atEnd && garbage >= COMPACT_MIN_GARBAGE && 2 * garbage > arena.size()) {
+				//note: runs are updated in place, so pointer to run remains valid
+				CompactArena();
+				atEnd = (run->offset + run->capacity == arena.size());
+			}
+			if (atEnd) {
+				//run is at the end of arena: extend it in place
+				arena.push_back(ValueTraits::GetEmpty());
+				run->capacity++;
+			}
+			else
+				MoveToEnd(*run, std::max(2 * run->length, size_t(RUN_MIN_CAPACITY)));
+		}
+		Value &dst = arena[run->offset + run->length++];
+		dst = AWH_MOVE(value);
+		valuesCount++;
+		return &dst;
+	}
+
+	//remove all values for a given key
+	//returns number of removed values
+	AWH_INLINE size_t RemoveKey(Key key) {
+		Run *run = runs.GetPtr(key);
+		if (!run)
+			return 0;
+		size_t cnt = run->length;
+		Release(run->offset, run->capacity);
+		valuesCount -= cnt;
+		runs.RemovePtr(run);
+		return cnt;
+	}
+
+	//pack all runs tightly into a new arena, removing all garbage and spare cells
+	//it is called automatically by Append when garbage makes more than half of arena
+	AWH_NOINLINE void CompactArena() {
+		std::vector<Value> newArena;
+		newArena.reserve(valuesCount);
+		CompactAction action = {&arena, &newArena};
+		runs.ForEach(action);
+		arena.swap(newArena);
+		garbage = 0;
+	}
+
+	//perform given action for all values of a given key (in order of insertion)
+	//callback is specified as a functor with signature:
+	//  bool action(Value &value);
+	//it must return: false to continue iteration, true to stop it
+	template<class Action> AWH_INLINE void ForEachValue(Key key, Action &action) const {
+		size_t cnt;
+		Value *values = GetValues(key, cnt);
+		for (size_t i = 0; i < cnt; i++)
+			if (action(values[i]))
+				return;
+	}
+
+	//perform given action for all (key, value) pairs in this container
+	//values of each key are visited consecutively (in order of insertion)
+	//callback is specified as a functor with signature:
+	//  bool action(Key key, Value &value);
+	//it must return: false to continue iteration, true to stop it
+	template<class Action> void ForEach(Action &action) const {
+		PairsAction<Action> adapter;
+		adapter.arena = const_cast<std::vector<Value>*>(&arena);
+		adapter.action = &action;
+		runs.ForEach(adapter);
+	}
+
+#ifdef AWH_TESTING
+	//internal method: checks all the invariants of the container
+	AWH_NOINLINE bool AssertCorrectness(int verbosity = 2) const {
+		runs.AssertCorrectness(verbosity);
+		if (verbosity >= 1) {
+			//runs do not intersect, and all the other cells are garbage
+			std::vector<char> used(arena.size(), 0);
+			size_t totalLength = 0, totalCapacity = 0;
+			CheckAction action = {&arena, &used, &totalLength, &totalCapacity};
+			runs.ForEach(action);
+			for (size_t i = 0; i < arena.size(); i++)
+				AWH_ASSERT_ALWAYS(used[i] || ValueTraits::IsEmpty(arena[i]));
+			AWH_ASSERT_ALWAYS(totalLength == valuesCount);
+			AWH_ASSERT_ALWAYS(totalCapacity + garbage == arena.size());
+		}
+		return true;
+	}
+#endif
+};
+
+//end namespace
+}
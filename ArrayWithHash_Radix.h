@@ -0,0 +1,417 @@
+//          Copyright Stepan Gatilov 2016.
+// Distributed under the Boost Software License, Version 1.0.
+//      (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "ArrayWithHash.h"
+
+//namespace for ArrayWithHash
+namespace AWH_NAMESPACE {
+
+//radix tree for keys which are locally dense but globally sparse (e.g. addresses)
+//Key is split into prefix (high bits) and index (lower LEAF_BITS bits).
+//Each populated prefix has a leaf in one of two forms:
+//  sparse: sorted list of at most SPARSE_CAPACITY pairs (index, value)
+//  dense: array of 2^LEAF_BITS values (empty value = no element)
+//Sparse leaf becomes dense when it overflows, and dense leaf becomes sparse again
+//when at most SPARSE_CAPACITY/2 elements are left in it (so that forms do not flip too often).
+//Prefixes are mapped to leaves by directory, which is ArrayWithHash itself:
+//it keeps dense prefixes in its array part, and compresses sparse ones into its hash table.
+//So isolated keys cost only a few cells each, every dense region has array-like locality,
+//and traversal in order of keys needs sorting of prefixes only.
+//note: keys are ordered as unsigned integers (i.e. negative keys go after positive ones)
+//note: LEAF_BITS must be positive and less than the number of bits in Key
+template<
+	class TKey, class TValue,
+#ifndef AWH_NO_CPP11
+	int LEAF_BITS = 8,
+	class TKeyTraits = DefaultKeyTraits<TKey>, class TValueTraits = DefaultValueTraits<TValue>
+#else
+	int LEAF_BITS, class TKeyTraits, class TValueTraits
+#endif
+>
+class RadixArrayWithHash {
+public:
+	//accessing template arguments from outside
+	typedef TKey Key;
+	typedef TValue Value;
+	typedef TKeyTraits KeyTraits;
+	typedef TValueTraits ValueTraits;
+	//default unsigned integer type
+	typedef typename KeyTraits::Size Size;
+
+	//number of values in each leaf
+	static const Size LEAF_SIZE = Size(1) << LEAF_BITS;
+	//max number of elements in sparse leaf
+	static const Size SPARSE_CAPACITY = (LEAF_SIZE / 2 < 8 ? LEAF_SIZE / 2 : 8);
+
+private:
+	//raw memory for a single value (constructed in dense leaf, and in used part of sparse leaf)
+#ifndef AWH_NO_CPP11
+	typedef typename std::aligned_storage<sizeof(Value), std::alignment_of<Value>::value>::type RawValue;
+#else
+	union RawValue { char bytes[sizeof(Value)]; double d; long long ll; void *p; };
+#endif
+
+	//moves values when memcpy cannot be used (same as in ArrayWithHash)
+	typedef ValueMover<Value, RelocateWithSwap<ValueTraits>::value> Mover;
+
+	//common header of both leaf forms
+	struct Leaf {
+		//number of elements in leaf
+		Size count;
+		//form of leaf: DenseLeaf or SparseLeaf
+		bool dense;
+	};
+	//dense array of values with common prefix
+	struct DenseLeaf : Leaf {
+		//values for all indices (empty value if element is absent)
+		RawValue raw[1 << LEAF_BITS];
+
+		AWH_INLINE Value *Values() {
+			return (Value*)raw;
+		}
+		DenseLeaf() {
+			this->count = 0;
+			this->dense = true;
+			for (Size i = 0; i < LEAF_SIZE; i++)
+				new (&Values()[i]) Value(ValueTraits::GetEmpty());
+		}
+		~DenseLeaf() {
+			for (Size i = 0; i < LEAF_SIZE; i++)
+				Values()[i].~Value();
+		}
+	};
+	//sorted list of elements with common prefix
+	struct SparseLeaf : Leaf {
+		//indices of elements in increasing order
+		Size indices[SPARSE_CAPACITY];
+		//values of elements (only first count of them are constructed)
+		RawValue raw[SPARSE_CAPACITY];
+
+		AWH_INLINE Value *Values() {
+			return (Value*)raw;
+		}
+		SparseLeaf() {
+			this->count = 0;
+			this->dense = false;
+		}
+		~SparseLeaf() {
+			for (Size i = 0; i < this->count; i++)
+				Values()[i].~Value();
+		}
+		//returns position of the first index not less than given one
+		AWH_INLINE Size LowerBound(Size index) const {
+			Size pos = 0;
+			while (pos < this->count && indices[pos] < index)
+				pos++;
+			return pos;
+		}
+		//inserts empty value with given index at position pos (leaf must not be full)
+		AWH_INLINE Value *Insert(Size pos, Size index) {
+			Value *values = Values();
+			Size last = this->count;
+			if (pos == last)
+				new (&values[last]) Value(ValueTraits::GetEmpty());
+			else {
+				Mover::Construct(&values[last], values[last - 1]);
+				for (Size i = last - 1; i > pos; i--)
+					Mover::Assign(values[i], values[i - 1]);
+				values[pos] = ValueTraits::GetEmpty();
+			}
+			for (Size i = last; i > pos; i--)
+				indices[i] = indices[i - 1];
+			indices[pos] = index;
+			this->count++;
+			return &values[pos];
+		}
+		//removes element at position pos
+		AWH_INLINE void Erase(Size pos) {
+			Value *values = Values();
+			for (Size i = pos; i + 1 < this->count; i++) {
+				Mover::Assign(values[i], values[i + 1]);
+				indices[i] = indices[i + 1];
+			}
+			values[--this->count].~Value();
+		}
+	};
+
+	//prefixes are never equal to maximal values (since they are shifted keys)
+	struct PrefixTraits {
+		typedef typename KeyTraits::Size Size;
+		static const Size EMPTY_KEY = Size(-1);
+		static const Size REMOVED_KEY = Size(-2);
+		static AWH_INLINE Size HashFunction(Size prefix) {
+			return Size(KeyTraits::HashFunction(Key(prefix)));
+		}
+	};
+	//pointer to leaf is empty iff it is NULL
+	struct LeafPtrTraits {
+		static const bool RELOCATE_WITH_MEMCPY = true;
+		static AWH_INLINE bool IsEmpty(Leaf *leaf) {
+			return leaf == NULL;
+		}
+		static AWH_INLINE Leaf *GetEmpty() {
+			return NULL;
+		}
+	};
+	typedef ArrayWithHash<Size, Leaf*, PrefixTraits, LeafPtrTraits> Directory;
+
+	//prefix -> leaf
+	Directory leaves;
+	//total number of elements
+	Size count;
+
+	static AWH_INLINE Size PrefixOf(Key key) {
+		return Size(key) >> LEAF_BITS;
+	}
+	static AWH_INLINE Size IndexOf(Key key) {
+		return Size(key) & (LEAF_SIZE - 1);
+	}
+
+	static AWH_INLINE void DeleteLeaf(Leaf *leaf) {
+		if (leaf->dense)
+			delete static_cast<DenseLeaf*>(leaf);
+		else
+			delete static_cast<SparseLeaf*>(leaf);
+	}
+	//converts overflown sparse leaf into dense one (old leaf is deleted)
+	static AWH_NOINLINE Leaf *ToDense(SparseLeaf *sparse) {
+		DenseLeaf *dense = new DenseLeaf();
+		for (Size i = 0; i < sparse->count; i++)
+			Mover::Assign(dense->Values()[sparse->indices[i]], sparse->Values()[i]);
+		dense->count = sparse->count;
+		delete sparse;
+		return dense;
+	}
+	//converts underfull dense leaf into sparse one (old leaf is deleted)
+	static AWH_NOINLINE Leaf *ToSparse(DenseLeaf *dense) {
+		SparseLeaf *sparse = new SparseLeaf();
+		Value *values = dense->Values();
+		for (Size i = 0; i < LEAF_SIZE; i++)
+			if (!ValueTraits::IsEmpty(values[i])) {
+				Mover::Construct(&sparse->Values()[sparse->count], values[i]);
+				sparse->indices[sparse->count++] = i;
+			}
+		delete dense;
+		return sparse;
+	}
+
+	//returns pointer to the value with given index in leaf, or NULL if it is absent
+	static AWH_INLINE Value *FindInLeaf(Leaf *leaf, Size index) {
+		if (leaf->dense) {
+			Value *ptr = &static_cast<DenseLeaf*>(leaf)->Values()[index];
+			return ValueTraits::IsEmpty(*ptr) ? NULL : ptr;
+		}
+		SparseLeaf *sparse = static_cast<SparseLeaf*>(leaf);
+		Size pos = sparse->LowerBound(index);
+		return pos < sparse->count && sparse->indices[pos] == index ? &sparse->Values()[pos] : NULL;
+	}
+	//returns pointer to the value for given key, inserts empty value if key is absent
+	//isNew is set iff the key was absent: then caller must assign nonempty value to it
+	AWH_INLINE Value *Emplace(Key key, bool &isNew) {
+		Leaf **slot = leaves.GetPtr(PrefixOf(key));
+		if (!slot)
+			slot = leaves.Set(PrefixOf(key), new SparseLeaf());
+		Size index = IndexOf(key);
+		if (!(*slot)->dense) {
+			SparseLeaf *sparse = static_cast<SparseLeaf*>(*slot);
+			Size pos = sparse->LowerBound(index);
+			isNew = !(pos < sparse->count && sparse->indices[pos] == index);
+			if (!isNew)
+				return &sparse->Values()[pos];
+			if (sparse->count < SPARSE_CAPACITY) {
+				count++;
+				return sparse->Insert(pos, index);
+			}
+			*slot = ToDense(sparse);
+		}
+		DenseLeaf *dense = static_cast<DenseLeaf*>(*slot);
+		Value &dst = dense->Values()[index];
+		isNew = ValueTraits::IsEmpty(dst);
+		dense->count += isNew;
+		count += isNew;
+		return &dst;
+	}
+
+	//deletes all leaves
+	struct DeleteAction {
+		AWH_INLINE bool operator() (Size, Leaf *&leaf) const {
+			DeleteLeaf(leaf);
+			return false;
+		}
+	};
+	//adapter for iterating over elements of all leaves
+	template<class Action> struct LeafAction {
+		Action *action;
+		AWH_INLINE bool operator() (Size prefix, Leaf *&leaf) const {
+			if (leaf->dense) {
+				Value *values = static_cast<DenseLeaf*>(leaf)->Values();
+				for (Size i = 0; i < LEAF_SIZE; i++)
+					if (!ValueTraits::IsEmpty(values[i]) && (*action)(Key((prefix << LEAF_BITS) | i), values[i]))
+						return true;
+				return false;
+			}
+			SparseLeaf *sparse = static_cast<SparseLeaf*>(leaf);
+			for (Size i = 0; i < sparse->count; i++)
+				if ((*action)(Key((prefix << LEAF_BITS) | sparse->indices[i]), sparse->Values()[i]))
+					return true;
+			return false;
+		}
+	};
+
+	//note: RadixArrayWithHash is non-copyable (just like ArrayWithHash)
+	RadixArrayWithHash (const RadixArrayWithHash &iSource);
+	void operator= (const RadixArrayWithHash &iSource);
+
+public:
+	RadixArrayWithHash() : count(0) {}
+	AWH_NOINLINE ~RadixArrayWithHash() {
+		DeleteAction action;
+		leaves.ForEach(action);
+	}
+
+	//fast O(1) swap of this object and another one
+	void Swap(RadixArrayWithHash &other) {
+		leaves.Swap(other.leaves);
+		std::swap(count, other.count);
+	}
+
+	//remove all elements from container (all leaves are freed)
+	AWH_NOINLINE void Clear() {
+		DeleteAction action;
+		leaves.ForEach(action);
+		leaves.Clear();
+		count = 0;
+	}
+
+	//return number of elements currently inside
+	AWH_INLINE Size GetSize() const {
+		return count;
+	}
+	//return number of populated leaves (of both forms)
+	AWH_INLINE Size GetLeavesCount() const {
+		return leaves.GetSize();
+	}
+
+	//return pointer to the value for a given key, or NULL if it is not present
+	AWH_INLINE Value *GetPtr(Key key) const {
+		Leaf **leaf = leaves.GetPtr(PrefixOf(key));
+		return leaf ? FindInLeaf(*leaf, IndexOf(key)) : NULL;
+	}
+	//return value for a given key (empty value if it is not present)
+	AWH_INLINE Value Get(Key key) const {
+		Value *ptr = GetPtr(key);
+		return ptr ? *ptr : ValueTraits::GetEmpty();
+	}
+
+	//set value for a given key, returns pointer to the value inside
+	AWH_INLINE Value *Set(Key key, Value value) {
+		assert(!ValueTraits::IsEmpty(value));
+		bool isNew;
+		Value *dst = Emplace(key, isNew);
+		*dst = AWH_MOVE(value);
+		return dst;
+	}
+	//if key is present, then returns pointer to it
+	//otherwise inserts a new key with associated value, and returns NULL
+	AWH_INLINE Value *SetIfNew(Key key, Value value) {
+		assert(!ValueTraits::IsEmpty(value));
+		bool isNew;
+		Value *dst = Emplace(key, isNew);
+		if (!isNew)
+			return dst;
+		*dst = AWH_MOVE(value);
+		return NULL;
+	}
+
+	//remove element with given key (if present)
+	//leaf is freed when its last element is removed
+	AWH_INLINE void Remove(Key key) {
+		Leaf **slot = leaves.GetPtr(PrefixOf(key));
+		if (!slot)
+			return;
+		Size index = IndexOf(key);
+		if ((*slot)->dense) {
+			DenseLeaf *dense = static_cast<DenseLeaf*>(*slot);
+			Value &dst = dense->Values()[index];
+			if (ValueTraits::IsEmpty(dst))
+				return;
+			dst = ValueTraits::GetEmpty();
+			if (--dense->count > 0 && dense->count <= SPARSE_CAPACITY / 2)
+				*slot = ToSparse(dense);
+		}
+		else {
+			SparseLeaf *sparse = static_cast<SparseLeaf*>(*slot);
+			Size pos = sparse->LowerBound(index);
+			if (pos == sparse->count || sparse->indices[pos] != index)
+				return;
+			sparse->Erase(pos);
+		}
+		count--;
+		if ((*slot)->count == 0) {
+			DeleteLeaf(*slot);
+			leaves.RemovePtr(slot);
+		}
+	}
+
+	//perform given action for all the elements in this container
+	//elements of each leaf go consecutively, but order of leaves is arbitrary
+	//callback is specified as a functor with signature:
+	//  bool action(Key key, Value &value);
+	//it must return: false to continue iteration, true to stop it
+	template<class Action> void ForEach(Action &action) const {
+		LeafAction<Action> adapter = {&action};
+		leaves.ForEach(adapter);
+	}
+	//perform given action for all the elements in this container in order of increasing keys
+	//only prefixes in hash part of directory are sorted (see ArrayWithHash::ForEachSorted)
+	//see ForEach for details about callback
+	template<class Action> void ForEachSorted(Action &action) const {
+		LeafAction<Action> adapter = {&action};
+		leaves.ForEachSorted(adapter);
+	}
+
+#ifdef AWH_TESTING
+	//checks counter of elements and form of leaf (see AssertCorrectness)
+	struct CheckAction {
+		Size *total;
+		bool operator() (Size, Leaf *&leaf) const {
+			if (leaf->dense) {
+				Size cnt = 0;
+				for (Size i = 0; i < LEAF_SIZE; i++)
+					cnt += !ValueTraits::IsEmpty(static_cast<DenseLeaf*>(leaf)->Values()[i]);
+				AWH_ASSERT_ALWAYS(cnt == leaf->count && cnt > SPARSE_CAPACITY / 2);
+			}
+			else {
+				SparseLeaf *sparse = static_cast<SparseLeaf*>(leaf);
+				AWH_ASSERT_ALWAYS(sparse->count <= SPARSE_CAPACITY);
+				Size *indices = sparse->indices;
+				for (Size i = 0; i < sparse->count; i++)
+					AWH_ASSERT_ALWAYS(!ValueTraits::IsEmpty(sparse->Values()[i]));
+				for (Size i = 0; i < sparse->count; i++)
+					AWH_ASSERT_ALWAYS(indices[i] < LEAF_SIZE && (i == 0 || indices[i - 1] < indices[i]));
+			}
+			AWH_ASSERT_ALWAYS(leaf->count > 0);
+			*total += leaf->count;
+			return false;
+		}
+	};
+	//internal method: checks all the invariants of the container
+	AWH_NOINLINE bool AssertCorrectness(int verbosity = 2) const {
+		leaves.AssertCorrectness(verbosity);
+		if (verbosity >= 1) {
+			Size total = 0;
+			CheckAction action = {&total};
+			leaves.ForEach(action);
+			AWH_ASSERT_ALWAYS(total == count);
+		}
+		return true;
+	}
+#endif
+};
+
+//end namespace
+}
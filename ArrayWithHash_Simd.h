@@ -0,0 +1,398 @@
+//          Copyright Stepan Gatilov 2016.
+// Distributed under the Boost Software License, Version 1.0.
+//      (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "ArrayWithHash_Utils.h"
+
+//SIMD kernels are compiled only for x86 (unless disabled by user)
+//every kernel has scalar version, which is used on other platforms
+#if !defined(AWH_NO_SIMD) && (defined(__GNUC__) || defined(_MSC_VER)) && \
+	(defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+	#define AWH_SIMD
+#endif
+
+#ifdef AWH_SIMD
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h>
+		//note: MSVC allows intrinsics of any instruction set in any function
+		#define AWH_TARGET(isa)
+	#else
+		#define AWH_TARGET(isa) __attribute__((target(isa)))
+	#endif
+#endif
+
+//namespace for ArrayWithHash
+namespace AWH_NAMESPACE {
+
+//number of keys processed by one call of a SIMD kernel (one bit per key in mask)
+static AWH_CONSTEXPR size_t SIMD_BLOCK = 32;
+
+//instruction sets for which kernels are implemented
+enum SimdLevel {
+	SIMD_SCALAR = 0,
+	SIMD_SSE42 = 1,
+	SIMD_AVX2 = 2,
+	SIMD_AVX512 = 3	//AVX-512 F and CD
+};
+
+//detect the best instruction set supported by current CPU and OS
+static AWH_NOINLINE SimdLevel DetectSimdLevel() {
+#if !defined(AWH_SIMD)
+	return SIMD_SCALAR;
+#elif defined(_MSC_VER)
+	int regs[4];
+	__cpuid(regs, 0);
+	if (regs[0] < 7)
+		return SIMD_SCALAR;
+	__cpuid(regs, 1);
+	bool sse42 = (regs[2] >> 20) & 1;
+	bool osxsave = (regs[2] >> 27) & 1;
+	uint64_t xcr0 = osxsave ? _xgetbv(0) : 0;
+	__cpuidex(regs, 7, 0);
+	//OS must save YMM (and ZMM) registers on context switch
+	if (((regs[1] >> 16) & 1) && ((regs[1] >> 28) & 1) && (xcr0 & 0xE6) == 0xE6)
+		return SIMD_AVX512;
+	if (((regs[1] >> 5) & 1) && (xcr0 & 0x06) == 0x06)
+		return SIMD_AVX2;
+	return sse42 ? SIMD_SSE42 : SIMD_SCALAR;
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512cd"))
+		return SIMD_AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return SIMD_AVX2;
+	if (__builtin_cpu_supports("sse4.2"))
+		return SIMD_SSE42;
+	return SIMD_SCALAR;
+#endif
+}
+
+//instruction set used by all the kernels (detected once on first call)
+static AWH_INLINE SimdLevel GetSimdLevel() {
+	//note: without C++11 initialization may race, which is harmless
+	static const SimdLevel level = DetectSimdLevel();
+	return level;
+}
+
+//integer type used by kernels for keys of given type
+//note: SIMD versions of kernels are implemented only for 32-bit and 64-bit keys
+template<class Key, int BYTES = sizeof(Key)> struct SimdWord { typedef Key type; };
+template<class Key> struct SimdWord<Key, 1> { typedef uint8_t type; };
+template<class Key> struct SimdWord<Key, 2> { typedef uint16_t type; };
+template<class Key> struct SimdWord<Key, 4> { typedef uint32_t type; };
+template<class Key> struct SimdWord<Key, 8> { typedef uint64_t type; };
+
+//======================================================================
+//Kernel: compute bitmask of valid keys (neither EMPTY nor REMOVED) among SIMD_BLOCK keys.
+//Used to skip free cells quickly when iterating over hash part.
+
+//scalar version: reference for all the others
+template<class Word> static uint32_t SimdValidMaskScalar(const Word *keys, Word emptyKey, Word removedKey) {
+	uint32_t mask = 0;
+	for (size_t i = 0; i < SIMD_BLOCK; i++)
+		mask |= uint32_t(keys[i] != emptyKey && keys[i] != removedKey) << i;
+	return mask;
+}
+
+#ifdef AWH_SIMD
+AWH_TARGET("sse4.2") static inline uint32_t SimdValidMaskSse42(const uint32_t *keys, uint32_t emptyKey, uint32_t removedKey) {
+	__m128i e = _mm_set1_epi32(int(emptyKey)), r = _mm_set1_epi32(int(removedKey));
+	uint32_t invalid = 0;
+	for (size_t i = 0; i < SIMD_BLOCK; i += 4) {
+		__m128i k = _mm_loadu_si128((const __m128i*)(keys + i));
+		__m128i bad = _mm_or_si128(_mm_cmpeq_epi32(k, e), _mm_cmpeq_epi32(k, r));
+		invalid |= uint32_t(_mm_movemask_ps(_mm_castsi128_ps(bad))) << i;
+	}
+	return ~invalid;
+}
+AWH_TARGET("sse4.2") static inline uint32_t SimdValidMaskSse42(const uint64_t *keys, uint64_t emptyKey, uint64_t removedKey) {
+	__m128i e = _mm_set1_epi64x(int64_t(emptyKey)), r = _mm_set1_epi64x(int64_t(removedKey));
+	uint32_t invalid = 0;
+	for (size_t i = 0; i < SIMD_BLOCK; i += 2) {
+		__m128i k = _mm_loadu_si128((const __m128i*)(keys + i));
+		__m128i bad = _mm_or_si128(_mm_cmpeq_epi64(k, e), _mm_cmpeq_epi64(k, r));
+		invalid |= uint32_t(_mm_movemask_pd(_mm_castsi128_pd(bad))) << i;
+	}
+	return ~invalid;
+}
+AWH_TARGET("avx2") static inline uint32_t SimdValidMaskAvx2(const uint32_t *keys, uint32_t emptyKey, uint32_t removedKey) {
+	__m256i e = _mm256_set1_epi32(int(emptyKey)), r = _mm256_set1_epi32(int(removedKey));
+	uint32_t invalid = 0;
+	for (size_t i = 0; i < SIMD_BLOCK; i += 8) {
+		__m256i k = _mm256_loadu_si256((const __m256i*)(keys + i));
+		__m256i bad = _mm256_or_si256(_mm256_cmpeq_epi32(k, e), _mm256_cmpeq_epi32(k, r));
+		invalid |= uint32_t(_mm256_movemask_ps(_mm256_castsi256_ps(bad))) << i;
+	}
+	return ~invalid;
+}
+AWH_TARGET("avx2") static inline uint32_t SimdValidMaskAvx2(const uint64_t *keys, uint64_t emptyKey, uint64_t removedKey) {
+	__m256i e = _mm256_set1_epi64x(int64_t(emptyKey)), r = _mm256_set1_epi64x(int64_t(removedKey));
+	uint32_t invalid = 0;
+	for (size_t i = 0; i < SIMD_BLOCK; i += 4) {
+		__m256i k = _mm256_loadu_si256((const __m256i*)(keys + i));
+		__m256i bad = _mm256_or_si256(_mm256_cmpeq_epi64(k, e), _mm256_cmpeq_epi64(k, r));
+		invalid |= uint32_t(_mm256_movemask_pd(_mm256_castsi256_pd(bad))) << i;
+	}
+	return ~invalid;
+}
+AWH_TARGET("avx512f") static inline uint32_t SimdValidMaskAvx512(const uint32_t *keys, uint32_t emptyKey, uint32_t removedKey) {
+	__m512i e = _mm512_set1_epi32(int(emptyKey)), r = _mm512_set1_epi32(int(removedKey));
+	uint32_t valid = 0;
+	for (size_t i = 0; i < SIMD_BLOCK; i += 16) {
+		__m512i k = _mm512_loadu_si512((const void*)(keys + i));
+		__mmask16 good = _mm512_cmpneq_epi32_mask(k, e) & _mm512_cmpneq_epi32_mask(k, r);
+		valid |= uint32_t(good) << i;
+	}
+	return valid;
+}
+AWH_TARGET("avx512f") static inline uint32_t SimdValidMaskAvx512(const uint64_t *keys, uint64_t emptyKey, uint64_t removedKey) {
+	__m512i e = _mm512_set1_epi64(int64_t(emptyKey)), r = _mm512_set1_epi64(int64_t(removedKey));
+	uint32_t valid = 0;
+	for (size_t i = 0; i < SIMD_BLOCK; i += 8) {
+		__m512i k = _mm512_loadu_si512((const void*)(keys + i));
+		__mmask8 good = _mm512_cmpneq_epi64_mask(k, e) & _mm512_cmpneq_epi64_mask(k, r);
+		valid |= uint32_t(good) << i;
+	}
+	return valid;
+}
+#endif
+
+//======================================================================
+//Kernel: add lengths (see log2size) of all valid keys among count keys to histogram.
+//Used to choose new sizes of parts on reallocation (see AdaptSizes).
+//Histogram must have SIMD_HISTO_SIZE elements, count must be divisible by SIMD_BLOCK.
+
+//number of elements in histogram of key lengths (from 0 to 64)
+static AWH_CONSTEXPR size_t SIMD_HISTO_SIZE = 65;
+
+//lengths of all keys in a block are computed at once, then they are counted one by one
+//invalid keys get length SIMD_HISTO_SIZE, i.e. they are counted in extra element (dropped)
+//four histograms are used in turn, so that equal lengths do not wait for each other
+template<class Len> static inline void SimdCountLengths(const Len *lens, uint64_t (*sub)[SIMD_HISTO_SIZE + 1]) {
+	for (size_t i = 0; i < SIMD_BLOCK; i += 4) {
+		sub[0][lens[i + 0]]++;
+		sub[1][lens[i + 1]]++;
+		sub[2][lens[i + 2]]++;
+		sub[3][lens[i + 3]]++;
+	}
+}
+static inline void SimdMergeHistos(uint64_t (*sub)[SIMD_HISTO_SIZE + 1], uint64_t *histo) {
+	for (size_t t = 0; t < SIMD_HISTO_SIZE; t++)
+		histo[t] += sub[0][t] + sub[1][t] + sub[2][t] + sub[3][t];
+}
+
+//scalar version: reference for all the others
+template<class Word> static void SimdLogHistoScalar(const Word *keys, size_t count, Word emptyKey, Word removedKey, uint64_t *histo) {
+	uint64_t sub[4][SIMD_HISTO_SIZE + 1] = {{0}};
+	uint32_t lens[SIMD_BLOCK];
+	for (size_t b = 0; b < count; b += SIMD_BLOCK) {
+		for (size_t i = 0; i < SIMD_BLOCK; i++) {
+			Word key = keys[b + i];
+			bool valid = (key != emptyKey && key != removedKey);
+			lens[i] = valid ? uint32_t(log2size(key)) : uint32_t(SIMD_HISTO_SIZE);
+		}
+		SimdCountLengths(lens, sub);
+	}
+	SimdMergeHistos(sub, histo);
+}
+
+#ifdef AWH_SIMD
+//lengths of 32-bit integers are computed using exponent of their conversion to float:
+//x is halved to avoid signed overflow, then z & ~(z >> 1) is taken to avoid rounding up
+//length(x) = length(z) + 1 = (exponent(z) - 126) + 1, except for x = 0 or 1 (when z = 0)
+AWH_TARGET("sse4.2") static inline __m128i SimdLength32Sse42(__m128i x) {
+	__m128i z = _mm_srli_epi32(x, 1);
+	z = _mm_andnot_si128(_mm_srli_epi32(z, 1), z);
+	__m128i e = _mm_srli_epi32(_mm_castps_si128(_mm_cvtepi32_ps(z)), 23);
+	__m128i nonzero = _mm_add_epi32(_mm_cmpeq_epi32(x, _mm_setzero_si128()), _mm_set1_epi32(1));
+	return _mm_max_epi32(_mm_sub_epi32(e, _mm_set1_epi32(125)), nonzero);
+}
+AWH_TARGET("avx2") static inline __m256i SimdLength32Avx2(__m256i x) {
+	__m256i z = _mm256_srli_epi32(x, 1);
+	z = _mm256_andnot_si256(_mm256_srli_epi32(z, 1), z);
+	__m256i e = _mm256_srli_epi32(_mm256_castps_si256(_mm256_cvtepi32_ps(z)), 23);
+	__m256i nonzero = _mm256_add_epi32(_mm256_cmpeq_epi32(x, _mm256_setzero_si256()), _mm256_set1_epi32(1));
+	return _mm256_max_epi32(_mm256_sub_epi32(e, _mm256_set1_epi32(125)), nonzero);
+}
+
+AWH_TARGET("sse4.2") static inline void SimdLogHistoSse42(const uint32_t *keys, size_t count, uint32_t emptyKey, uint32_t removedKey, uint64_t *histo) {
+	uint64_t sub[4][SIMD_HISTO_SIZE + 1] = {{0}};
+	uint32_t lens[SIMD_BLOCK];
+	__m128i e = _mm_set1_epi32(int(emptyKey)), r = _mm_set1_epi32(int(removedKey));
+	__m128i sink = _mm_set1_epi32(int(SIMD_HISTO_SIZE));
+	for (size_t b = 0; b < count; b += SIMD_BLOCK) {
+		for (size_t i = 0; i < SIMD_BLOCK; i += 4) {
+			__m128i k = _mm_loadu_si128((const __m128i*)(keys + b + i));
+			__m128i bad = _mm_or_si128(_mm_cmpeq_epi32(k, e), _mm_cmpeq_epi32(k, r));
+			__m128i len = _mm_blendv_epi8(SimdLength32Sse42(k), sink, bad);
+			_mm_storeu_si128((__m128i*)(lens + i), len);
+		}
+		SimdCountLengths(lens, sub);
+	}
+	SimdMergeHistos(sub, histo);
+}
+AWH_TARGET("sse4.2") static inline void SimdLogHistoSse42(const uint64_t *keys, size_t count, uint64_t emptyKey, uint64_t removedKey, uint64_t *histo) {
+	uint64_t sub[4][SIMD_HISTO_SIZE + 1] = {{0}};
+	uint64_t lens[SIMD_BLOCK];
+	__m128i e = _mm_set1_epi64x(int64_t(emptyKey)), r = _mm_set1_epi64x(int64_t(removedKey));
+	__m128i sink = _mm_set1_epi64x(int64_t(SIMD_HISTO_SIZE));
+	for (size_t b = 0; b < count; b += SIMD_BLOCK) {
+		for (size_t i = 0; i < SIMD_BLOCK; i += 2) {
+			__m128i k = _mm_loadu_si128((const __m128i*)(keys + b + i));
+			__m128i bad = _mm_or_si128(_mm_cmpeq_epi64(k, e), _mm_cmpeq_epi64(k, r));
+			//combine lengths of 32-bit halves: high half if it is nonzero, low half otherwise
+			__m128i halves = SimdLength32Sse42(k);
+			__m128i hi = _mm_srli_epi64(halves, 32);
+			__m128i lo = _mm_and_si128(halves, _mm_set1_epi64x(0xFFFFFFFF));
+			__m128i hiZero = _mm_cmpeq_epi64(hi, _mm_setzero_si128());
+			__m128i len = _mm_blendv_epi8(_mm_add_epi64(hi, _mm_set1_epi64x(32)), lo, hiZero);
+			len = _mm_blendv_epi8(len, sink, bad);
+			_mm_storeu_si128((__m128i*)(lens + i), len);
+		}
+		SimdCountLengths(lens, sub);
+	}
+	SimdMergeHistos(sub, histo);
+}
+AWH_TARGET("avx2") static inline void SimdLogHistoAvx2(const uint32_t *keys, size_t count, uint32_t emptyKey, uint32_t removedKey, uint64_t *histo) {
+	uint64_t sub[4][SIMD_HISTO_SIZE + 1] = {{0}};
+	uint32_t lens[SIMD_BLOCK];
+	__m256i e = _mm256_set1_epi32(int(emptyKey)), r = _mm256_set1_epi32(int(removedKey));
+	__m256i sink = _mm256_set1_epi32(int(SIMD_HISTO_SIZE));
+	for (size_t b = 0; b < count; b += SIMD_BLOCK) {
+		for (size_t i = 0; i < SIMD_BLOCK; i += 8) {
+			__m256i k = _mm256_loadu_si256((const __m256i*)(keys + b + i));
+			__m256i bad = _mm256_or_si256(_mm256_cmpeq_epi32(k, e), _mm256_cmpeq_epi32(k, r));
+			__m256i len = _mm256_blendv_epi8(SimdLength32Avx2(k), sink, bad);
+			_mm256_storeu_si256((__m256i*)(lens + i), len);
+		}
+		SimdCountLengths(lens, sub);
+	}
+	SimdMergeHistos(sub, histo);
+}
+AWH_TARGET("avx2") static inline void SimdLogHistoAvx2(const uint64_t *keys, size_t count, uint64_t emptyKey, uint64_t removedKey, uint64_t *histo) {
+	uint64_t sub[4][SIMD_HISTO_SIZE + 1] = {{0}};
+	uint64_t lens[SIMD_BLOCK];
+	__m256i e = _mm256_set1_epi64x(int64_t(emptyKey)), r = _mm256_set1_epi64x(int64_t(removedKey));
+	__m256i sink = _mm256_set1_epi64x(int64_t(SIMD_HISTO_SIZE));
+	for (size_t b = 0; b < count; b += SIMD_BLOCK) {
+		for (size_t i = 0; i < SIMD_BLOCK; i += 4) {
+			__m256i k = _mm256_loadu_si256((const __m256i*)(keys + b + i));
+			__m256i bad = _mm256_or_si256(_mm256_cmpeq_epi64(k, e), _mm256_cmpeq_epi64(k, r));
+			//combine lengths of 32-bit halves: high half if it is nonzero, low half otherwise
+			__m256i halves = SimdLength32Avx2(k);
+			__m256i hi = _mm256_srli_epi64(halves, 32);
+			__m256i lo = _mm256_and_si256(halves, _mm256_set1_epi64x(0xFFFFFFFF));
+			__m256i hiZero = _mm256_cmpeq_epi64(hi, _mm256_setzero_si256());
+			__m256i len = _mm256_blendv_epi8(_mm256_add_epi64(hi, _mm256_set1_epi64x(32)), lo, hiZero);
+			len = _mm256_blendv_epi8(len, sink, bad);
+			_mm256_storeu_si256((__m256i*)(lens + i), len);
+		}
+		SimdCountLengths(lens, sub);
+	}
+	SimdMergeHistos(sub, histo);
+}
+//AVX-512 CD has vector version of lzcnt instruction
+AWH_TARGET("avx512f,avx512cd") static inline void SimdLogHistoAvx512(const uint32_t *keys, size_t count, uint32_t emptyKey, uint32_t removedKey, uint64_t *histo) {
+	uint64_t sub[4][SIMD_HISTO_SIZE + 1] = {{0}};
+	uint32_t lens[SIMD_BLOCK];
+	__m512i e = _mm512_set1_epi32(int(emptyKey)), r = _mm512_set1_epi32(int(removedKey));
+	__m512i sink = _mm512_set1_epi32(int(SIMD_HISTO_SIZE)), bits = _mm512_set1_epi32(32);
+	for (size_t b = 0; b < count; b += SIMD_BLOCK) {
+		for (size_t i = 0; i < SIMD_BLOCK; i += 16) {
+			__m512i k = _mm512_loadu_si512((const void*)(keys + b + i));
+			__mmask16 bad = _mm512_cmpeq_epi32_mask(k, e) | _mm512_cmpeq_epi32_mask(k, r);
+			__m512i len = _mm512_sub_epi32(bits, _mm512_lzcnt_epi32(k));
+			len = _mm512_mask_mov_epi32(len, bad, sink);
+			_mm512_storeu_si512((void*)(lens + i), len);
+		}
+		SimdCountLengths(lens, sub);
+	}
+	SimdMergeHistos(sub, histo);
+}
+AWH_TARGET("avx512f,avx512cd") static inline void SimdLogHistoAvx512(const uint64_t *keys, size_t count, uint64_t emptyKey, uint64_t removedKey, uint64_t *histo) {
+	uint64_t sub[4][SIMD_HISTO_SIZE + 1] = {{0}};
+	uint64_t lens[SIMD_BLOCK];
+	__m512i e = _mm512_set1_epi64(int64_t(emptyKey)), r = _mm512_set1_epi64(int64_t(removedKey));
+	__m512i sink = _mm512_set1_epi64(int64_t(SIMD_HISTO_SIZE)), bits = _mm512_set1_epi64(64);
+	for (size_t b = 0; b < count; b += SIMD_BLOCK) {
+		for (size_t i = 0; i < SIMD_BLOCK; i += 8) {
+			__m512i k = _mm512_loadu_si512((const void*)(keys + b + i));
+			__mmask8 bad = _mm512_cmpeq_epi64_mask(k, e) | _mm512_cmpeq_epi64_mask(k, r);
+			__m512i len = _mm512_sub_epi64(bits, _mm512_lzcnt_epi64(k));
+			len = _mm512_mask_mov_epi64(len, bad, sink);
+			_mm512_storeu_si512((void*)(lens + i), len);
+		}
+		SimdCountLengths(lens, sub);
+	}
+	SimdMergeHistos(sub, histo);
+}
+#endif
+
+//======================================================================
+
+//set of all kernels for keys stored as Word-s
+//GetXXX(level) returns version of kernel for given instruction set (NULL if not implemented)
+//XXX() returns version of kernel chosen for current CPU
+//general template: only scalar versions are available
+template<class Word> struct SimdKernels {
+	typedef uint32_t (*ValidMaskFunc)(const Word *keys, Word emptyKey, Word removedKey);
+	typedef void (*LogHistoFunc)(const Word *keys, size_t count, Word emptyKey, Word removedKey, uint64_t *histo);
+
+	static ValidMaskFunc GetValidMask(SimdLevel level) {
+		return level == SIMD_SCALAR ? &SimdValidMaskScalar<Word> : NULL;
+	}
+	static AWH_INLINE ValidMaskFunc ValidMask() {
+		return &SimdValidMaskScalar<Word>;
+	}
+	static LogHistoFunc GetLogHisto(SimdLevel level) {
+		return level == SIMD_SCALAR ? &SimdLogHistoScalar<Word> : NULL;
+	}
+	static AWH_INLINE LogHistoFunc LogHisto() {
+		return &SimdLogHistoScalar<Word>;
+	}
+};
+
+#ifdef AWH_SIMD
+//kernels for 32-bit and 64-bit keys: dispatched at runtime
+template<class Word> struct SimdKernelsDispatched {
+	typedef uint32_t (*ValidMaskFunc)(const Word *keys, Word emptyKey, Word removedKey);
+
+	static ValidMaskFunc GetValidMask(SimdLevel level) {
+		switch (level) {
+			case SIMD_SCALAR: return &SimdValidMaskScalar<Word>;
+			case SIMD_SSE42: return &SimdValidMaskSse42;
+			case SIMD_AVX2: return &SimdValidMaskAvx2;
+			case SIMD_AVX512: return &SimdValidMaskAvx512;
+		}
+		return NULL;
+	}
+	static AWH_INLINE ValidMaskFunc ValidMask() {
+		static const ValidMaskFunc func = GetValidMask(GetSimdLevel());
+		return func;
+	}
+
+	typedef void (*LogHistoFunc)(const Word *keys, size_t count, Word emptyKey, Word removedKey, uint64_t *histo);
+	static LogHistoFunc GetLogHisto(SimdLevel level) {
+		switch (level) {
+			case SIMD_SCALAR: return &SimdLogHistoScalar<Word>;
+			case SIMD_SSE42: return &SimdLogHistoSse42;
+			case SIMD_AVX2: return &SimdLogHistoAvx2;
+			case SIMD_AVX512: return &SimdLogHistoAvx512;
+		}
+		return NULL;
+	}
+	static AWH_INLINE LogHistoFunc LogHisto() {
+		static const LogHistoFunc func = GetLogHisto(GetSimdLevel());
+		return func;
+	}
+};
+template<> struct SimdKernels<uint32_t> : public SimdKernelsDispatched<uint32_t> {};
+template<> struct SimdKernels<uint64_t> : public SimdKernelsDispatched<uint64_t> {};
+#endif
+
+//end namespace
+}
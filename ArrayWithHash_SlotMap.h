@@ -0,0 +1,233 @@
+//          Copyright Stepan Gatilov 2016.
+// Distributed under the Boost Software License, Version 1.0.
+//      (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "ArrayWithHash.h"
+#include <vector>
+
+//namespace for ArrayWithHash
+namespace AWH_NAMESPACE {
+
+//handle of an element in SlotMapArrayWithHash
+//index is the key in the underlying container, generation detects stale handles
+template<class Index> struct SlotHandle {
+	Index index;
+	uint32_t generation;
+
+	AWH_INLINE bool operator== (const SlotHandle &other) const {
+		return index == other.index && generation == other.generation;
+	}
+	AWH_INLINE bool operator!= (const SlotHandle &other) const {
+		return !(*this == other);
+	}
+};
+
+//array with hash table, which allocates keys (IDs) for inserted values by itself
+//Insert returns a handle, which can later be used to access or remove the element.
+//Freed IDs are reused before new ones are taken, so keys are always dense: all of them
+//are kept in the array part (it is reserved in advance), and the hash part stays empty.
+//Each ID has a generation, which is incremented when its element is removed,
+//so any access with a stale handle is detected in O(1) (GetPtr returns NULL).
+//note: generation is 32-bit, so a handle can be mistaken for a valid one only
+//if its ID has been reused exactly 2^32 times since the handle was obtained
+template<
+	class TValue,
+#ifndef AWH_NO_CPP11
+	class TIndex = uint32_t,
+	class TKeyTraits = DefaultKeyTraits<TIndex>, class TValueTraits = DefaultValueTraits<TValue>
+#else
+	class TIndex, class TKeyTraits, class TValueTraits
+#endif
+>
+class SlotMapArrayWithHash {
+public:
+	//accessing template arguments from outside
+	typedef TValue Value;
+	typedef TIndex Index;
+	typedef TKeyTraits KeyTraits;
+	typedef TValueTraits ValueTraits;
+	//default unsigned integer type
+	typedef typename KeyTraits::Size Size;
+	//handle of element: returned by Insert
+	typedef SlotHandle<Index> Handle;
+	//underlying container: ID -> value
+	typedef ArrayWithHash<Index, Value, KeyTraits, ValueTraits> ValueMap;
+
+	//special index: denotes end of free list (and index of null handle)
+	static const Index NO_INDEX = KeyTraits::EMPTY_KEY;
+
+private:
+	//metadata of an ID (kept even when the ID is free)
+	struct Slot {
+		//current generation: handles with other generation are stale
+		uint32_t generation;
+		//next free ID in the free list (only for free IDs)
+		Index nextFree;
+	};
+
+	//ID -> value (only for IDs in use)
+	ValueMap values;
+	//ID -> metadata, for all IDs ever allocated
+	std::vector<Slot> slots;
+	//first ID in the list of free IDs (LIFO order), NO_INDEX if list is empty
+	Index freeHead;
+	//size of the array part reserved in values
+	Size capacity;
+
+	//allocate new ID (free list is empty)
+	//array part is extended in advance, so that all IDs are always in it
+	AWH_NOINLINE Index NewIndex() {
+		Index index = Index(slots.size());
+		assert(index != NO_INDEX && index != KeyTraits::REMOVED_KEY);
+		if (Size(index) >= capacity) {
+			capacity = std::max(Size(2) * capacity, Size(ARRAY_MIN_SIZE));
+			values.Reserve(capacity, 0);
+		}
+		Slot slot = {0, NO_INDEX};
+		slots.push_back(slot);
+		return index;
+	}
+
+	//adapter for iterating over handles instead of IDs
+	template<class Action> struct HandleAction {
+		const Slot *slots;
+		Action *action;
+		AWH_INLINE bool operator() (Index index, Value &value) const {
+			Handle handle = {index, slots[index].generation};
+			return (*action)(handle, value);
+		}
+	};
+
+	//note: SlotMapArrayWithHash is non-copyable (just like ArrayWithHash)
+	SlotMapArrayWithHash (const SlotMapArrayWithHash &iSource);
+	void operator= (const SlotMapArrayWithHash &iSource);
+
+public:
+	SlotMapArrayWithHash() : freeHead(NO_INDEX), capacity(0) {}
+
+	//handle which never refers to any element
+	static AWH_INLINE Handle NullHandle() {
+		Handle res = {NO_INDEX, 0};
+		return res;
+	}
+
+	//fast O(1) swap of this object and another one
+	void Swap(SlotMapArrayWithHash &other) {
+		values.Swap(other.values);
+		slots.swap(other.slots);
+		std::swap(freeHead, other.freeHead);
+		std::swap(capacity, other.capacity);
+	}
+
+	//remove all elements from container without shrinking
+	//note: all IDs become free, and all old handles become stale
+	AWH_NOINLINE void Clear() {
+		values.Clear();
+		freeHead = NO_INDEX;
+		//IDs are pushed in reverse order, so that lower IDs are allocated first
+		for (size_t i = slots.size(); i > 0; i--) {
+			Slot &slot = slots[i - 1];
+			slot.generation++;
+			slot.nextFree = freeHead;
+			freeHead = Index(i - 1);
+		}
+	}
+
+	//return number of elements currently inside
+	AWH_INLINE Size GetSize() const {
+		return values.GetSize();
+	}
+	//return number of IDs ever allocated (all IDs are less than this number)
+	AWH_INLINE Size GetIdsCount() const {
+		return Size(slots.size());
+	}
+
+	//reserve memory for given number of elements
+	void Reserve(Size count) {
+		if (count > capacity) {
+			capacity = Size(1) << log2up(count);
+			values.Reserve(capacity, 0);
+		}
+		slots.reserve(size_t(count));
+	}
+
+	//check whether the handle refers to an element currently inside
+	AWH_INLINE bool IsValid(Handle handle) const {
+		return Size(handle.index) < Size(slots.size()) && slots[handle.index].generation == handle.generation;
+	}
+
+	//return pointer to the value for a given handle, or NULL if handle is stale
+	AWH_INLINE Value *GetPtr(Handle handle) const {
+		if (!IsValid(handle))
+			return NULL;
+		return values.GetPtr(handle.index);
+	}
+
+	//insert given value under a newly allocated ID, returns handle of the new element
+	//the most recently freed ID is reused if there is any, otherwise a new ID is taken
+	AWH_INLINE Handle Insert(Value value) {
+		assert(!ValueTraits::IsEmpty(value));
+		Index index = freeHead;
+		if (index != NO_INDEX)
+			freeHead = slots[index].nextFree;
+		else
+			index = NewIndex();
+		values.Set(index, AWH_MOVE(value));
+		Handle res = {index, slots[index].generation};
+		return res;
+	}
+
+	//remove element with the given handle
+	//returns false if the handle is stale (then nothing is changed)
+	AWH_INLINE bool Remove(Handle handle) {
+		if (!IsValid(handle))
+			return false;
+		values.Remove(handle.index);
+		Slot &slot = slots[handle.index];
+		slot.generation++;
+		slot.nextFree = freeHead;
+		freeHead = handle.index;
+		return true;
+	}
+
+	//read-only access to the underlying container with all elements by IDs
+	AWH_INLINE const ValueMap &GetValues() const {
+		return values;
+	}
+
+	//perform given action for all the elements in this container
+	//callback is specified as a functor with signature:
+	//  bool action(Handle handle, Value &value);
+	//it must return: false to continue iteration, true to stop it
+	template<class Action> void ForEach(Action &action) const {
+		HandleAction<Action> adapter;
+		adapter.slots = slots.empty() ? NULL : &slots[0];
+		adapter.action = &action;
+		values.ForEach(adapter);
+	}
+
+#ifdef AWH_TESTING
+	//internal method: checks all the invariants of the container
+	AWH_NOINLINE bool AssertCorrectness(int verbosity = 2) const {
+		values.AssertCorrectness(verbosity);
+		AWH_ASSERT_ALWAYS(Size(slots.size()) <= capacity);
+		if (verbosity >= 1) {
+			//each ID is either free (in free list) or used (present in values)
+			Size freeCount = 0;
+			for (Index i = freeHead; i != NO_INDEX; i = slots[i].nextFree) {
+				AWH_ASSERT_ALWAYS(Size(i) < Size(slots.size()) && !values.GetPtr(i));
+				freeCount++;
+				AWH_ASSERT_ALWAYS(freeCount <= Size(slots.size()));
+			}
+			AWH_ASSERT_ALWAYS(freeCount + values.GetSize() == Size(slots.size()));
+		}
+		return true;
+	}
+#endif
+};
+
+//end namespace
+}
@@ -0,0 +1,429 @@
+//          Copyright Stepan Gatilov 2016.
+// Distributed under the Boost Software License, Version 1.0.
+//      (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "ArrayWithHash.h"
+
+//namespace for ArrayWithHash
+namespace AWH_NAMESPACE {
+
+//array with hash table, optimized for tiny maps
+//Up to N elements are stored inline (inside the object) without any heap allocations.
+//When more elements are inserted, all of them are moved into usual ArrayWithHash allocated on heap.
+//Just like parts of ArrayWithHash, it never shrinks back to inline storage (unless swapped).
+//Interface is a subset of ArrayWithHash interface: basic operations (Get, GetPtr, Set, SetIfNew,
+//Remove, RemovePtr, KeyOf), Reserve, ForEach, SampleRandom, Clear, Swap, CloneTo.
+//If you need other methods (e.g. set algebra or columns), use ArrayWithHash itself.
+template<
+	class TKey, class TValue,
+#ifndef AWH_NO_CPP11
+	int N = 4,
+	class TKeyTraits = DefaultKeyTraits<TKey>, class TValueTraits = DefaultValueTraits<TValue>
+#else
+	int N, class TKeyTraits, class TValueTraits
+#endif
+>
+class SmallArrayWithHash {
+public:
+	//accessing template arguments from outside
+	typedef TKey Key;
+	typedef TValue Value;
+	typedef TKeyTraits KeyTraits;
+	typedef TValueTraits ValueTraits;
+	//default unsigned integer type
+	typedef typename KeyTraits::Size Size;
+	//pointer to value is used as iterator
+	typedef Value *Ptr;
+	//container used after inline storage is exceeded
+	typedef ArrayWithHash<Key, Value, KeyTraits, ValueTraits> Large;
+
+private:
+	//pseudonyms for making code more readable
+	static const Key EMPTY_KEY = KeyTraits::EMPTY_KEY;
+	static const Key REMOVED_KEY = KeyTraits::REMOVED_KEY;
+	//special value of count: elements are stored in heap-allocated container
+	static const uint32_t SPILLED = uint32_t(-1);
+
+	//raw memory for a single value (not constructed unless cell is occupied)
+#ifndef AWH_NO_CPP11
+	typedef typename std::aligned_storage<sizeof(Value), std::alignment_of<Value>::value>::type RawValue;
+#else
+	union RawValue { char bytes[sizeof(Value)]; double d; long long ll; void *p; };
+#endif
+
+	//inline: number of elements, or SPILLED if large container is used
+	uint32_t count;
+	union {
+		struct {
+			//inline: key of each cell, EMPTY_KEY if cell is free
+			Key keys[N];
+			//inline: value of each cell (alive only if cell is occupied)
+			RawValue values[N];
+		} inl;
+		//spilled: pointer to heap-allocated container
+		Large *large;
+	};
+
+	AWH_INLINE Value *InlineValues() const {
+		return (Value*)inl.values;
+	}
+	AWH_INLINE bool IsSpilled() const {
+		return count == SPILLED;
+	}
+
+	//moves values when memcpy cannot be used (same as in ArrayWithHash)
+	typedef ValueMover<Value, RelocateWithSwap<ValueTraits>::value> Mover;
+
+	//relocate single value from alive src to dead dst (same as in ArrayWithHash)
+	static AWH_INLINE void RelocateOne(Value &dst, Value &src) {
+		if (ValueTraits::RELOCATE_WITH_MEMCPY)
+			memcpy((void*)&dst, (void*)&src, sizeof(Value));
+		else {
+			Mover::Construct(&dst, src);
+			src.~Value();
+		}
+	}
+
+	//returns inline cell index with given key, or N if not present
+	AWH_INLINE int FindCell(Key key) const {
+		int res = N;
+		for (int i = N - 1; i >= 0; i--)
+			res = (inl.keys[i] == key ? i : res);	//branchless
+		return res;
+	}
+
+	//deletes large container unless released (if exception is thrown while filling it)
+	struct LargeGuard {
+		Large *ptr;
+		~LargeGuard() {
+			delete ptr;
+		}
+	};
+
+	//move all inline elements into newly created large container
+	//note: inline values are destroyed only after all of them are moved successfully
+	AWH_NOINLINE void Spill(Size arraySizeLB, Size hashSizeLB) {
+		LargeGuard guard = {new Large()};
+		guard.ptr->Reserve(arraySizeLB, hashSizeLB);
+		Value *values = InlineValues();
+		for (int i = 0; i < N; i++)
+			if (inl.keys[i] != EMPTY_KEY)
+				guard.ptr->Set(inl.keys[i], AWH_MOVE(values[i]));
+		Destroy();
+		large = guard.ptr;
+		guard.ptr = NULL;
+		count = SPILLED;
+	}
+	//spill due to inline storage overflow
+	AWH_INLINE void SpillFull() {
+		//note: reserve hash part only, array part is created automatically if keys are small
+		Spill(0, 2 * N + 2);
+	}
+
+	//initialize this object to empty state
+	AWH_INLINE void Flush() {
+		count = 0;
+		for (int i = 0; i < N; i++)
+			inl.keys[i] = EMPTY_KEY;
+	}
+	//move all elements from source object into this one (must be dead)
+	//source object is left dead
+	AWH_INLINE void RelocateFrom(SmallArrayWithHash &iSource) {
+		count = iSource.count;
+		if (iSource.IsSpilled()) {
+			large = iSource.large;
+			return;
+		}
+		Value *values = InlineValues(), *srcValues = iSource.InlineValues();
+		for (int i = 0; i < N; i++) {
+			inl.keys[i] = iSource.inl.keys[i];
+			if (inl.keys[i] != EMPTY_KEY)
+				RelocateOne(values[i], srcValues[i]);
+		}
+	}
+	//destroy all elements and free all memory
+	AWH_INLINE void Destroy() {
+		if (IsSpilled()) {
+			delete large;
+			return;
+		}
+		Value *values = InlineValues();
+		for (int i = 0; i < N; i++)
+			if (inl.keys[i] != EMPTY_KEY)
+				values[i].~Value();
+	}
+
+	//note: SmallArrayWithHash is non-copyable (just like ArrayWithHash)
+	SmallArrayWithHash (const SmallArrayWithHash &iSource);
+	void operator= (const SmallArrayWithHash &iSource);
+
+public:
+	SmallArrayWithHash() {
+		Flush();
+	}
+	~SmallArrayWithHash() {
+		Destroy();
+	}
+
+#ifndef AWH_NO_CPP11
+	//container is movable in C++11
+	//note: source object is reset to empty state
+	SmallArrayWithHash(SmallArrayWithHash &&iSource) {
+		RelocateFrom(iSource);
+		iSource.Flush();
+	}
+	void operator= (SmallArrayWithHash &&iSource) {
+		Destroy();
+		RelocateFrom(iSource);
+		iSource.Flush();
+	}
+#endif
+
+	//swap this object and another one
+	//note: takes O(N) time, since inline elements are swapped cell by cell
+	void Swap(SmallArrayWithHash &other) {
+		if (IsSpilled() && other.IsSpilled()) {
+			std::swap(large, other.large);
+			return;
+		}
+		if (IsSpilled() || other.IsSpilled()) {
+			SmallArrayWithHash &spilled = (IsSpilled() ? *this : other);
+			SmallArrayWithHash &inlined = (IsSpilled() ? other : *this);
+			Large *ptr = spilled.large;
+			spilled.RelocateFrom(inlined);
+			inlined.large = ptr;
+			inlined.count = SPILLED;
+			return;
+		}
+		Value *values = InlineValues(), *otherValues = other.InlineValues();
+		for (int i = 0; i < N; i++) {
+			bool alive = (inl.keys[i] != EMPTY_KEY), otherAlive = (other.inl.keys[i] != EMPTY_KEY);
+			if (alive && otherAlive) {
+				using std::swap;
+				swap(values[i], otherValues[i]);
+			}
+			else if (alive)
+				RelocateOne(otherValues[i], values[i]);
+			else if (otherAlive)
+				RelocateOne(values[i], otherValues[i]);
+			std::swap(inl.keys[i], other.inl.keys[i]);
+		}
+		std::swap(count, other.count);
+	}
+
+	//make target container an exact copy of this one (old contents of target are destroyed)
+	//note: Value must be copyable
+	AWH_NOINLINE void CloneTo(SmallArrayWithHash &target) const {
+		if (&target == this)
+			return;
+		target.Destroy();
+		target.Flush();
+		if (IsSpilled()) {
+			LargeGuard guard = {new Large()};
+			large->CloneTo(*guard.ptr);
+			target.large = guard.ptr;
+			guard.ptr = NULL;
+			target.count = SPILLED;
+			return;
+		}
+		//note: key is set after value is constructed, so target remains valid if copy throws
+		Value *values = InlineValues(), *targetValues = target.InlineValues();
+		for (int i = 0; i < N; i++)
+			if (inl.keys[i] != EMPTY_KEY) {
+				new (&targetValues[i]) Value(values[i]);
+				target.inl.keys[i] = inl.keys[i];
+				target.count++;
+			}
+	}
+
+	//remove all elements from container without shrinking
+	AWH_NOINLINE void Clear() {
+		if (IsSpilled())
+			large->Clear();
+		else {
+			Destroy();
+			Flush();
+		}
+	}
+
+	//return number of elements currently inside
+	AWH_INLINE Size GetSize() const {
+		return IsSpilled() ? large->GetSize() : Size(count);
+	}
+
+	//return value for given key, or EMPTY value if the key is not present
+	AWH_INLINE Value Get(Key key) const {
+		assert(key != EMPTY_KEY && key != REMOVED_KEY);
+		if (IsSpilled())
+			return large->Get(key);
+		int cell = FindCell(key);
+		return cell == N ? ValueTraits::GetEmpty() : InlineValues()[cell];
+	}
+
+	//return pointer to the value for a given key, or NULL if key is not present
+	AWH_INLINE Value *GetPtr(Key key) const {
+		assert(key != EMPTY_KEY && key != REMOVED_KEY);
+		if (IsSpilled())
+			return large->GetPtr(key);
+		int cell = FindCell(key);
+		return cell == N ? NULL : &InlineValues()[cell];
+	}
+
+	//set the value associated with the given key
+	//returns pointer to the updated/inserted value
+	AWH_INLINE Value *Set(Key key, Value value) {
+		assert(key != EMPTY_KEY && key != REMOVED_KEY);
+		assert(!ValueTraits::IsEmpty(value));
+		if (!IsSpilled()) {
+			int cell = FindCell(key);
+			if (cell != N) {
+				Value &oldVal = InlineValues()[cell];
+				Mover::Assign(oldVal, value);
+				return &oldVal;
+			}
+			cell = FindCell(EMPTY_KEY);
+			if (cell != N) {
+				inl.keys[cell] = key;
+				count++;
+				Mover::Construct(&InlineValues()[cell], value);
+				return &InlineValues()[cell];
+			}
+			SpillFull();
+		}
+		return large->Set(key, AWH_MOVE(value));
+	}
+
+	//if key is present, then returns pointer to it
+	//otherwise inserts a new key with associated value, and returns NULL
+	AWH_INLINE Value *SetIfNew(Key key, Value value) {
+		assert(key != EMPTY_KEY && key != REMOVED_KEY);
+		assert(!ValueTraits::IsEmpty(value));
+		if (!IsSpilled()) {
+			int cell = FindCell(key);
+			if (cell != N)
+				return &InlineValues()[cell];
+			cell = FindCell(EMPTY_KEY);
+			if (cell != N) {
+				inl.keys[cell] = key;
+				count++;
+				Mover::Construct(&InlineValues()[cell], value);
+				return NULL;
+			}
+			SpillFull();
+		}
+		return large->SetIfNew(key, AWH_MOVE(value));
+	}
+
+	//remove element with the given key (if present)
+	AWH_INLINE void Remove(Key key) {
+		assert(key != EMPTY_KEY && key != REMOVED_KEY);
+		if (IsSpilled())
+			return large->Remove(key);
+		int cell = FindCell(key);
+		if (cell == N)
+			return;
+		inl.keys[cell] = EMPTY_KEY;
+		count--;
+		InlineValues()[cell].~Value();
+	}
+
+	//remove element specified by pointer to its value
+	AWH_INLINE void RemovePtr(Value *ptr) {
+		assert(ptr);
+		if (IsSpilled())
+			return large->RemovePtr(ptr);
+		size_t cell = ptr - InlineValues();
+		assert(cell < size_t(N) && inl.keys[cell] != EMPTY_KEY);
+		inl.keys[cell] = EMPTY_KEY;
+		count--;
+		ptr->~Value();
+	}
+
+	//get key for the given value pointer
+	AWH_INLINE Key KeyOf(Value *ptr) const {
+		assert(ptr);
+		if (IsSpilled())
+			return large->KeyOf(ptr);
+		return inl.keys[ptr - InlineValues()];
+	}
+
+#ifndef AWH_NO_CPP11
+	//return pointer to a uniformly random element, or NULL if container is empty
+	//see ArrayWithHash::SampleRandom for details
+	template<class Rng> AWH_INLINE Value *SampleRandom(Rng &rng) const {
+		if (IsSpilled())
+			return large->SampleRandom(rng);
+		if (count == 0)
+			return NULL;
+		int idx = std::uniform_int_distribution<int>(0, int(count) - 1)(rng);
+		for (int i = 0; ; i++)
+			if (inl.keys[i] != EMPTY_KEY && idx-- == 0)
+				return &InlineValues()[i];
+	}
+#endif
+
+	//force to reserve some memory for both array and hash table parts
+	//inline storage is retained if it can hold the requested number of elements
+	//see ArrayWithHash::Reserve for details
+	AWH_NOINLINE void Reserve(Size arraySizeLB, Size hashSizeLB, bool alwaysCleanHash = false) {
+		if (!IsSpilled()) {
+			if (arraySizeLB <= Size(N) && hashSizeLB <= Size(N))
+				return;
+			Spill(arraySizeLB, hashSizeLB);
+		}
+		large->Reserve(arraySizeLB, hashSizeLB, alwaysCleanHash);
+	}
+
+	//perform given action for all the elements in this container
+	//see ArrayWithHash::ForEach for details
+	template<class Action> void ForEach(Action &action) const {
+		if (IsSpilled())
+			return large->ForEach(action);
+		Value *values = InlineValues();
+		for (int i = 0; i < N; i++)
+			if (inl.keys[i] != EMPTY_KEY)
+				if (action(Key(inl.keys[i]), values[i]))
+					return;
+	}
+
+#ifdef AWH_TESTING
+	//internal method: checks all the invariants of the container
+	AWH_NOINLINE bool AssertCorrectness(int verbosity = 2) const {
+		if (IsSpilled())
+			return large->AssertCorrectness(verbosity);
+		AWH_ASSERT_ALWAYS(count <= uint32_t(N));
+		uint32_t trueCount = 0;
+		for (int i = 0; i < N; i++) {
+			Key key = inl.keys[i];
+			AWH_ASSERT_ALWAYS(key != REMOVED_KEY);
+			if (key == EMPTY_KEY)
+				continue;
+			trueCount++;
+			//value must be alive and non-empty
+			AWH_ASSERT_ALWAYS(!ValueTraits::IsEmpty(InlineValues()[i]));
+			//each key must be unique
+			for (int j = 0; j < i; j++)
+				AWH_ASSERT_ALWAYS(inl.keys[j] != key);
+		}
+		AWH_ASSERT_ALWAYS(count == trueCount);
+		return true;
+	}
+#endif
+};
+
+//end namespace
+}
+
+//make sure std::swap works via Swap method
+namespace std {
+	template<class Key, class Value, int N, class KeyTraits, class ValueTraits>
+	AWH_INLINE void swap(
+		AWH_NAMESPACE::SmallArrayWithHash<Key, Value, N, KeyTraits, ValueTraits> &a,
+		AWH_NAMESPACE::SmallArrayWithHash<Key, Value, N, KeyTraits, ValueTraits> &b
+	) {
+		a.Swap(b);
+	}
+};
@@ -0,0 +1,301 @@
+//          Copyright Stepan Gatilov 2016.
+// Distributed under the Boost Software License, Version 1.0.
+//      (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "ArrayWithHash.h"
+
+//BMI2 instructions (pdep/pext) are used for Morton codes if compiler is allowed to emit them
+//note: they are very slow on AMD CPUs before Zen 3, define AWH_NO_BMI2 to avoid them
+#if defined(__BMI2__) && !defined(AWH_NO_BMI2) && (defined(__x86_64__) || defined(_M_X64))
+	#define AWH_BMI2
+	#include <immintrin.h>
+#endif
+
+//namespace for ArrayWithHash
+namespace AWH_NAMESPACE {
+
+//Morton code (Z-order) of 2D point: bits of x and y are interleaved (x goes to even bits)
+static AWH_INLINE uint64_t MortonEncode2(uint32_t x, uint32_t y) {
+#ifdef AWH_BMI2
+	return _pdep_u64(x, 0x5555555555555555ULL) | _pdep_u64(y, 0xAAAAAAAAAAAAAAAAULL);
+#else
+	uint64_t res[2] = {x, y};
+	for (int d = 0; d < 2; d++) {
+		uint64_t v = res[d];
+		v = (v | (v << 16)) & 0x0000FFFF0000FFFFULL;
+		v = (v | (v <<  8)) & 0x00FF00FF00FF00FFULL;
+		v = (v | (v <<  4)) & 0x0F0F0F0F0F0F0F0FULL;
+		v = (v | (v <<  2)) & 0x3333333333333333ULL;
+		v = (v | (v <<  1)) & 0x5555555555555555ULL;
+		res[d] = v;
+	}
+	return res[0] | (res[1] << 1);
+#endif
+}
+//inverse of MortonEncode2
+static AWH_INLINE void MortonDecode2(uint64_t code, uint32_t &x, uint32_t &y) {
+#ifdef AWH_BMI2
+	x = uint32_t(_pext_u64(code, 0x5555555555555555ULL));
+	y = uint32_t(_pext_u64(code, 0xAAAAAAAAAAAAAAAAULL));
+#else
+	uint64_t res[2] = {code, code >> 1};
+	for (int d = 0; d < 2; d++) {
+		uint64_t v = res[d] & 0x5555555555555555ULL;
+		v = (v | (v >>  1)) & 0x3333333333333333ULL;
+		v = (v | (v >>  2)) & 0x0F0F0F0F0F0F0F0FULL;
+		v = (v | (v >>  4)) & 0x00FF00FF00FF00FFULL;
+		v = (v | (v >>  8)) & 0x0000FFFF0000FFFFULL;
+		v = (v | (v >> 16)) & 0x00000000FFFFFFFFULL;
+		res[d] = v;
+	}
+	x = uint32_t(res[0]);
+	y = uint32_t(res[1]);
+#endif
+}
+
+//Morton code (Z-order) of 3D point: bits of x, y, z are interleaved
+//note: only lower 21 bits of each coordinate are used
+static AWH_INLINE uint64_t MortonEncode3(uint32_t x, uint32_t y, uint32_t z) {
+#ifdef AWH_BMI2
+	return _pdep_u64(x, 0x1249249249249249ULL) | _pdep_u64(y, 0x2492492492492492ULL) | _pdep_u64(z, 0x4924924924924924ULL);
+#else
+	uint64_t res[3] = {x, y, z};
+	for (int d = 0; d < 3; d++) {
+		uint64_t v = res[d] & 0x1FFFFF;
+		v = (v | (v << 32)) & 0x001F00000000FFFFULL;
+		v = (v | (v << 16)) & 0x001F0000FF0000FFULL;
+		v = (v | (v <<  8)) & 0x100F00F00F00F00FULL;
+		v = (v | (v <<  4)) & 0x10C30C30C30C30C3ULL;
+		v = (v | (v <<  2)) & 0x1249249249249249ULL;
+		res[d] = v;
+	}
+	return res[0] | (res[1] << 1) | (res[2] << 2);
+#endif
+}
+//inverse of MortonEncode3
+static AWH_INLINE void MortonDecode3(uint64_t code, uint32_t &x, uint32_t &y, uint32_t &z) {
+#ifdef AWH_BMI2
+	x = uint32_t(_pext_u64(code, 0x1249249249249249ULL));
+	y = uint32_t(_pext_u64(code, 0x2492492492492492ULL));
+	z = uint32_t(_pext_u64(code, 0x4924924924924924ULL));
+#else
+	uint64_t res[3] = {code, code >> 1, code >> 2};
+	for (int d = 0; d < 3; d++) {
+		uint64_t v = res[d] & 0x1249249249249249ULL;
+		v = (v | (v >>  2)) & 0x10C30C30C30C30C3ULL;
+		v = (v | (v >>  4)) & 0x100F00F00F00F00FULL;
+		v = (v | (v >>  8)) & 0x001F0000FF0000FFULL;
+		v = (v | (v >> 16)) & 0x001F00000000FFFFULL;
+		v = (v | (v >> 32)) & 0x00000000001FFFFFULL;
+		res[d] = v;
+	}
+	x = uint32_t(res[0]);
+	y = uint32_t(res[1]);
+	z = uint32_t(res[2]);
+#endif
+}
+
+//array with hash table keyed by points of 2D or 3D integer grid (e.g. tiles or voxels)
+//Points are converted to keys by Morton code (Z-order), so that spatially close points
+//usually have close keys. Dense region near origin goes into the array part, and
+//small boxes of grid correspond to contiguous pieces of memory there.
+//Coordinates must be nonnegative and less than MAX_COORD (2^31 for 2D, 2^21 for 3D).
+//Coordinate z is ignored for 2D container (it must be zero).
+template<
+	class TValue,
+#ifndef AWH_NO_CPP11
+	int DIMS = 2,
+	class TKeyTraits = DefaultKeyTraits<uint64_t>, class TValueTraits = DefaultValueTraits<TValue>
+#else
+	int DIMS, class TKeyTraits, class TValueTraits
+#endif
+>
+class SpatialArrayWithHash {
+public:
+	//accessing template arguments from outside
+	typedef TValue Value;
+	typedef TKeyTraits KeyTraits;
+	typedef TValueTraits ValueTraits;
+	//type of point coordinate
+	typedef uint32_t Coord;
+	//type of keys in underlying container (Morton codes)
+	typedef uint64_t Key;
+	//underlying container: Morton code -> value
+	typedef ArrayWithHash<Key, Value, KeyTraits, ValueTraits> ValueMap;
+
+	//number of bits in each coordinate
+	//note: they are limited so that Morton codes never coincide with EMPTY_KEY or REMOVED_KEY
+	static const int COORD_BITS = (DIMS == 2 ? 31 : 21);
+	//exclusive upper bound for all coordinates
+	static const Coord MAX_COORD = Coord(1) << COORD_BITS;
+
+private:
+	//all the elements: Morton code -> value
+	ValueMap values;
+
+	//check that the point is inside grid
+	static AWH_INLINE bool IsValidPoint(Coord x, Coord y, Coord z) {
+		return x < MAX_COORD && y < MAX_COORD && (DIMS == 2 ? z == 0 : z < MAX_COORD);
+	}
+
+	//calls action for the element if it is inside the box
+	template<class Action> struct FilterAction {
+		Coord boxMin[3], boxMax[3];
+		Action *action;
+		AWH_INLINE bool operator() (Key key, Value &value) const {
+			Coord p[3];
+			Decode(key, p[0], p[1], p[2]);
+			for (int d = 0; d < DIMS; d++)
+				if (p[d] < boxMin[d] || p[d] > boxMax[d])
+					return false;
+			return (*action)(p[0], p[1], p[2], value);
+		}
+	};
+
+	//visit all elements in aligned block of codes [start, start + 2^(DIMS*level)) which are inside box
+	//returns true if iteration was stopped by action
+	template<class Action> bool VisitBlock(Key start, int level, const Coord boxMin[3], const Coord boxMax[3], Action &action) const {
+		Coord lo[3], hi[3];
+		Decode(start, lo[0], lo[1], lo[2]);
+		bool inside = true;
+		for (int d = 0; d < DIMS; d++) {
+			hi[d] = lo[d] + ((Coord(1) << level) - 1);
+			if (hi[d] < boxMin[d] || lo[d] > boxMax[d])
+				return false;
+			inside &= (lo[d] >= boxMin[d] && hi[d] <= boxMax[d]);
+		}
+		Key blockSize = Key(1) << (DIMS * level);
+		if (inside) {
+			//whole block is inside: check all its codes in increasing order
+			for (Key code = start; code < start + blockSize; code++)
+				if (Value *ptr = values.GetPtr(code)) {
+					Coord p[3];
+					Decode(code, p[0], p[1], p[2]);
+					if (action(p[0], p[1], p[2], *ptr))
+						return true;
+				}
+			return false;
+		}
+		//children blocks go in increasing order of codes
+		Key childSize = blockSize >> DIMS;
+		for (int i = 0; i < (1 << DIMS); i++)
+			if (VisitBlock(start + i * childSize, level - 1, boxMin, boxMax, action))
+				return true;
+		return false;
+	}
+
+	//note: SpatialArrayWithHash is non-copyable (just like ArrayWithHash)
+	SpatialArrayWithHash (const SpatialArrayWithHash &iSource);
+	void operator= (const SpatialArrayWithHash &iSource);
+
+public:
+	SpatialArrayWithHash() {}
+
+	//convert point to key of underlying container
+	static AWH_INLINE Key Encode(Coord x, Coord y, Coord z = 0) {
+		assert(IsValidPoint(x, y, z));
+		return DIMS == 2 ? MortonEncode2(x, y) : MortonEncode3(x, y, z);
+	}
+	//convert key of underlying container to point
+	static AWH_INLINE void Decode(Key key, Coord &x, Coord &y, Coord &z) {
+		if (DIMS == 2) {
+			MortonDecode2(key, x, y);
+			z = 0;
+		}
+		else
+			MortonDecode3(key, x, y, z);
+	}
+
+	//fast O(1) swap of this object and another one
+	void Swap(SpatialArrayWithHash &other) {
+		values.Swap(other.values);
+	}
+	//remove all elements from container without shrinking
+	AWH_NOINLINE void Clear() {
+		values.Clear();
+	}
+	//return number of elements currently inside
+	AWH_INLINE typename KeyTraits::Size GetSize() const {
+		return values.GetSize();
+	}
+	//read-only access to the underlying container (keys are Morton codes)
+	AWH_INLINE const ValueMap &GetValues() const {
+		return values;
+	}
+
+	//return pointer to the value at a given point, or NULL if it is not present
+	AWH_INLINE Value *GetPtr(Coord x, Coord y, Coord z = 0) const {
+		return values.GetPtr(Encode(x, y, z));
+	}
+	//return value at a given point (empty value if it is not present)
+	AWH_INLINE Value Get(Coord x, Coord y, Coord z = 0) const {
+		return values.Get(Encode(x, y, z));
+	}
+	//set value at a given point, returns pointer to the value inside
+	AWH_INLINE Value *Set(Coord x, Coord y, Coord z, Value value) {
+		return values.Set(Encode(x, y, z), AWH_MOVE(value));
+	}
+	//set value at a given point of 2D container (same as above with z = 0)
+	AWH_INLINE Value *Set(Coord x, Coord y, Value value) {
+		assert(DIMS == 2);
+		return values.Set(Encode(x, y), AWH_MOVE(value));
+	}
+	//remove element at a given point (if present)
+	AWH_INLINE void Remove(Coord x, Coord y, Coord z = 0) {
+		values.Remove(Encode(x, y, z));
+	}
+
+	//perform given action for all the elements inside box [boxMin, boxMax] (inclusive)
+	//for small boxes, aligned blocks of Z-order curve intersecting the box are looked up,
+	//so elements are visited in increasing order of codes (i.e. in memory order of the array part)
+	//if box volume exceeds number of cells, the whole container is filtered instead (in its order)
+	//callback is specified as a functor with signature:
+	//  bool action(Coord x, Coord y, Coord z, Value &value);
+	//it must return: false to continue iteration, true to stop it
+	template<class Action> AWH_NOINLINE void ForEachInBox(const Coord boxMin[], const Coord boxMax[], Action &action) const {
+		double volume = 1.0;
+		for (int d = 0; d < DIMS; d++) {
+			assert(boxMin[d] < MAX_COORD && boxMax[d] < MAX_COORD);
+			if (boxMin[d] > boxMax[d])
+				return;
+			volume *= double(boxMax[d] - boxMin[d] + 1);
+		}
+		if (volume > double(values.GetCellsCount())) {
+			FilterAction<Action> adapter;
+			for (int d = 0; d < 3; d++) {
+				adapter.boxMin[d] = (d < DIMS ? boxMin[d] : 0);
+				adapter.boxMax[d] = (d < DIMS ? boxMax[d] : 0);
+			}
+			adapter.action = &action;
+			values.ForEach(adapter);
+		}
+		else
+			VisitBlock(0, COORD_BITS, boxMin, boxMax, action);
+	}
+
+	//perform given action for all the elements within given distance from the point
+	//distance is measured as maximum of coordinate differences (i.e. box around the point)
+	//see ForEachInBox for details
+	template<class Action> AWH_INLINE void ForEachNeighbor(Coord x, Coord y, Coord z, Coord radius, Action &action) const {
+		assert(IsValidPoint(x, y, z));
+		Coord center[3] = {x, y, z}, boxMin[3], boxMax[3];
+		for (int d = 0; d < 3; d++) {
+			boxMin[d] = (center[d] > radius ? center[d] - radius : 0);
+			boxMax[d] = (radius < MAX_COORD - 1 - center[d] ? center[d] + radius : MAX_COORD - 1);
+		}
+		ForEachInBox(boxMin, boxMax, action);
+	}
+
+#ifdef AWH_TESTING
+	//internal method: checks all the invariants of the container
+	AWH_NOINLINE bool AssertCorrectness(int verbosity = 2) const {
+		return values.AssertCorrectness(verbosity);
+	}
+#endif
+};
+
+//end namespace
+}
@@ -0,0 +1,190 @@
+//          Copyright Stepan Gatilov 2016.
+// Distributed under the Boost Software License, Version 1.0.
+//      (See accompanying file LICENSE.md or copy at
+//          http://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "ArrayWithHash.h"
+
+//C++14 is required: loops are necessary inside constexpr functions
+#if !(__cplusplus >= 201402L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201402L))
+	#error ArrayWithHash_Static.h requires C++14 compiler
+#endif
+
+//namespace for ArrayWithHash
+namespace AWH_NAMESPACE {
+
+//single element of the initializer list for StaticArrayWithHash
+template<class Key, class Value> struct StaticElement {
+	Key key;
+	Value value;
+};
+
+//empty value used by default in StaticArrayWithHash
+//note: it must be a compile-time constant, so it differs from DefaultValueTraits for pointers
+template<class Value> struct StaticEmptyValue {
+	static constexpr Value Get() { return IntegerMaxValue<Value>::max; }
+};
+template<class Value> struct StaticEmptyValue<Value*> {
+	static constexpr Value *Get() { return nullptr; }
+};
+
+//chooses size of the array part for given list of elements (at compile time)
+//same rule as in ArrayWithHash: maximal power of two with fill ratio at least ARRAY_MIN_FILL
+template<class Key, class Value, size_t Count>
+constexpr size_t StaticArraySize(const StaticElement<Key, Value> (&elems)[Count]) {
+	typedef typename DefaultKeyTraits<Key>::Size Size;
+	size_t res = 0;
+	for (int i = 0; i < int(8 * sizeof(Size)) - 1; i++) {
+		Size aSize = Size(1) << i;
+		size_t cnt = 0;
+		for (size_t j = 0; j < Count; j++)
+			cnt += (Size(elems[j].key) < aSize);
+		if (cnt > 0 && cnt >= ARRAY_MIN_FILL * aSize)
+			res = size_t(aSize);
+	}
+	return res;
+}
+//chooses size of the hash table part for given list of elements (at compile time)
+//minimal power of two with fill ratio less than 2 * HASH_MIN_FILL is chosen
+template<class Key, class Value, size_t Count>
+constexpr size_t StaticHashSize(const StaticElement<Key, Value> (&elems)[Count]) {
+	typedef typename DefaultKeyTraits<Key>::Size Size;
+	size_t arraySize = StaticArraySize(elems);
+	size_t cnt = 0;
+	for (size_t j = 0; j < Count; j++)
+		cnt += (Size(elems[j].key) >= arraySize);
+	if (cnt == 0)
+		return 0;
+	size_t res = 1;
+	while (cnt >= HASH_MIN_FILL * res * 2)
+		res *= 2;
+	return res;
+}
+
+//read-only array with hash table, built entirely at compile time
+//Sizes of parts must be computed by StaticArraySize and StaticHashSize, see AWH_STATIC_TABLE_TYPE.
+//Lookups work exactly as in ArrayWithHash (array part + linear probing in hash part).
+//Value type must be a literal type, e.g. integer or pointer to function.
+//Usage example:
+//  constexpr StaticElement<int, Handler> handlers[] = {{0, &OnNop}, {1, &OnLoad}, {1000, &OnHalt}};
+//  constexpr AWH_STATIC_TABLE_TYPE(handlers) table(handlers);
+template<
+	class TKey, class TValue, size_t ARRAY_SIZE, size_t HASH_SIZE,
+	class TKeyTraits = DefaultKeyTraits<TKey>
+>
+class StaticArrayWithHash {
+public:
+	//accessing template arguments from outside
+	typedef TKey Key;
+	typedef TValue Value;
+	typedef TKeyTraits KeyTraits;
+	//default unsigned integer type
+	typedef typename KeyTraits::Size Size;
+
+private:
+	//pseudonyms for making code more readable
+	static const Key EMPTY_KEY = KeyTraits::EMPTY_KEY;
+	static const Key REMOVED_KEY = KeyTraits::REMOVED_KEY;
+
+	//value returned for missing elements
+	Value emptyValue;
+	//number of elements
+	Size count;
+	//array part (zero-sized arrays are not allowed, so extra element is kept)
+	Value arrayValues[ARRAY_SIZE ? ARRAY_SIZE : 1];
+	//hash part: keys and values in separate buffers (just like in ArrayWithHash)
+	Key hashKeys[HASH_SIZE ? HASH_SIZE : 1];
+	Value hashValues[HASH_SIZE ? HASH_SIZE : 1];
+
+	static constexpr bool InArray(Key key) {
+		return Size(key) < Size(ARRAY_SIZE);
+	}
+	//returns the first cell which is EMPTY of contains specified key
+	constexpr Size FindCellKeyOrEmpty(Key key) const {
+		Size cell = KeyTraits::HashFunction(key) & Size(HASH_SIZE - 1);
+		while (hashKeys[cell] != EMPTY_KEY && hashKeys[cell] != key)
+			cell = (cell + 1) & Size(HASH_SIZE - 1);
+		return cell;
+	}
+
+public:
+	//build table from the list of elements
+	//if some key is present several times, the last value is used
+	template<size_t Count>
+	constexpr StaticArrayWithHash(const StaticElement<Key, Value> (&elems)[Count], Value empty = StaticEmptyValue<Value>::Get())
+		: emptyValue(empty), count(0), arrayValues(), hashKeys(), hashValues()
+	{
+		for (size_t i = 0; i < (ARRAY_SIZE ? ARRAY_SIZE : 1); i++)
+			arrayValues[i] = empty;
+		for (size_t i = 0; i < (HASH_SIZE ? HASH_SIZE : 1); i++) {
+			hashKeys[i] = EMPTY_KEY;
+			hashValues[i] = empty;
+		}
+		for (size_t i = 0; i < Count; i++) {
+			Key key = elems[i].key;
+			assert(key != EMPTY_KEY && key != REMOVED_KEY);
+			if (InArray(key)) {
+				count += (arrayValues[key] == empty);
+				arrayValues[key] = elems[i].value;
+			}
+			else {
+				//note: it fails to compile if table is too small for given elements
+				assert(HASH_SIZE > 0);
+				Size cell = FindCellKeyOrEmpty(key);
+				count += (hashKeys[cell] == EMPTY_KEY);
+				hashKeys[cell] = key;
+				hashValues[cell] = elems[i].value;
+			}
+		}
+	}
+
+	//return number of elements inside
+	constexpr Size GetSize() const {
+		return count;
+	}
+
+	//return value for given key, or empty value if the key is not present
+	constexpr Value Get(Key key) const {
+		if (InArray(key))
+			return arrayValues[key];
+		if (HASH_SIZE == 0)
+			return emptyValue;
+		Size cell = FindCellKeyOrEmpty(key);
+		return hashKeys[cell] == EMPTY_KEY ? emptyValue : hashValues[cell];
+	}
+
+	//return pointer to the value for a given key, or NULL if key is not present
+	constexpr const Value *GetPtr(Key key) const {
+		if (InArray(key))
+			return arrayValues[key] == emptyValue ? nullptr : &arrayValues[key];
+		if (HASH_SIZE == 0)
+			return nullptr;
+		Size cell = FindCellKeyOrEmpty(key);
+		return hashKeys[cell] == EMPTY_KEY ? nullptr : &hashValues[cell];
+	}
+
+	//perform given action for all the elements in this table
+	//see ArrayWithHash::ForEach for details
+	template<class Action> void ForEach(Action &action) const {
+		for (Size i = 0; i < Size(ARRAY_SIZE); i++)
+			if (!(arrayValues[i] == emptyValue))
+				if (action(Key(i), arrayValues[i]))
+					return;
+		for (Size i = 0; i < Size(HASH_SIZE); i++)
+			if (hashKeys[i] != EMPTY_KEY)
+				if (action(Key(hashKeys[i]), hashValues[i]))
+					return;
+	}
+};
+
+//type of StaticArrayWithHash suitable for given constexpr array of StaticElement-s
+#define AWH_STATIC_TABLE_TYPE(elems) \
+	AWH_NAMESPACE::StaticArrayWithHash< \
+		decltype(elems[0].key), decltype(elems[0].value), \
+		AWH_NAMESPACE::StaticArraySize(elems), AWH_NAMESPACE::StaticHashSize(elems) \
+	>
+
+//end namespace
+}
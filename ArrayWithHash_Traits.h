@@ -31,21 +31,21 @@ template<class type> struct IntegerMaxValue {
 
 //for 32-bit integers, introduced by Knuth:
 // http://stackoverflow.com/a/665545/556899
-static AWH_INLINE uint32_t DefaultHashFunction(uint32_t key) {
+static AWH_INLINE constexpr uint32_t DefaultHashFunction(uint32_t key) {
 	return 2654435761U * key;
 }
 //analogous hash function for 64-bit integers
-static AWH_INLINE uint64_t DefaultHashFunction(uint64_t key) {
+static AWH_INLINE constexpr uint64_t DefaultHashFunction(uint64_t key) {
 	return 11400714819323198485ULL * key;
 }
 //32-bit version is used for integers of smaller size
-static AWH_INLINE uint16_t DefaultHashFunction(uint16_t key) { return DefaultHashFunction(uint32_t(key)); }
-static AWH_INLINE uint8_t  DefaultHashFunction(uint8_t  key) { return DefaultHashFunction(uint32_t(key)); }
+static AWH_INLINE constexpr uint16_t DefaultHashFunction(uint16_t key) { return DefaultHashFunction(uint32_t(key)); }
+static AWH_INLINE constexpr uint8_t  DefaultHashFunction(uint8_t  key) { return DefaultHashFunction(uint32_t(key)); }
 //signed integers are treated as unsigned ones
-static AWH_INLINE uint64_t DefaultHashFunction( int64_t key) { return DefaultHashFunction(uint64_t(key)); }
-static AWH_INLINE uint32_t DefaultHashFunction( int32_t key) { return DefaultHashFunction(uint32_t(key)); }
-static AWH_INLINE uint16_t DefaultHashFunction( int16_t key) { return DefaultHashFunction(uint16_t(key)); }
-static AWH_INLINE uint8_t  DefaultHashFunction( int8_t  key) { return DefaultHashFunction(uint8_t (key)); }
+static AWH_INLINE constexpr uint64_t DefaultHashFunction( int64_t key) { return DefaultHashFunction(uint64_t(key)); }
+static AWH_INLINE constexpr uint32_t DefaultHashFunction( int32_t key) { return DefaultHashFunction(uint32_t(key)); }
+static AWH_INLINE constexpr uint16_t DefaultHashFunction( int16_t key) { return DefaultHashFunction(uint16_t(key)); }
+static AWH_INLINE constexpr uint8_t  DefaultHashFunction( int8_t  key) { return DefaultHashFunction(uint8_t (key)); }
 
 //=======================================================================
 //Here the value treated as the EMPTY one (by default) is defined.
@@ -150,7 +150,7 @@ template<class Key> struct DefaultKeyTraits {
 	static const Key REMOVED_KEY = EMPTY_KEY - 1;
 
 	//hash function used for hash table
-	static AWH_INLINE Size HashFunction(Key key) {
+	static AWH_INLINE constexpr Size HashFunction(Key key) {
 		return DefaultHashFunction(key);
 	}
 };
@@ -7,6 +7,11 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <new>
+#include <algorithm>
+#ifndef AWH_NO_CPP11
+#include <type_traits>
+#endif
 
 //macros for controlling inlining behavior (if wanted)
 #if defined(_MSC_VER) && defined(AWH_CONTROL_INLINING)
@@ -20,6 +25,16 @@
 	#define AWH_NOINLINE 
 #endif
 
+//macro for prefetching memory into cache (if supported)
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#include <xmmintrin.h>
+	#define AWH_PREFETCH(ptr) _mm_prefetch((const char*)(ptr), _MM_HINT_T0)
+#elif defined(__GNUC__)
+	#define AWH_PREFETCH(ptr) __builtin_prefetch(ptr)
+#else
+	#define AWH_PREFETCH(ptr) ((void)0)
+#endif
+
 #ifdef AWH_TESTING	//only for testing purposes
 	//assert that is never thrown away
 	#define AWH_ASSERT_ALWAYS(expr) { \
@@ -38,8 +53,10 @@
 //support the cases when C++11 is not available
 #ifndef AWH_NO_CPP11
 	#define AWH_MOVE(x) std::move(x)
+	#define AWH_CONSTEXPR constexpr
 #else
 	#define AWH_MOVE(x) x
+	#define AWH_CONSTEXPR const
 #endif
 
 
@@ -113,6 +130,121 @@ template<class Size> static AWH_INLINE Size log2up(Size x) {
 static AWH_INLINE uint16_t log2size(uint16_t sz) { return log2size(uint32_t(sz)); }
 static AWH_INLINE uint8_t log2size(uint8_t sz) { return log2size(uint32_t(sz)); }
 
+//returns index of the lowest set bit in nonzero X (i.e. number of trailing zeros)
+//used to iterate over bitmasks produced by SIMD kernels
+#if _MSC_VER >= 1600
+	static AWH_INLINE uint32_t ctz(uint32_t x) {
+		unsigned long pos;
+		_BitScanForward(&pos, (unsigned long)x);		//bsf
+		return uint32_t(pos);
+	}
+#elif __GNUC__
+	static AWH_INLINE uint32_t ctz(uint32_t x) {
+		return uint32_t(__builtin_ctz((unsigned int)x));	//bsf
+	}
+#else
+	static AWH_INLINE uint32_t ctz(uint32_t x) {
+		uint32_t pos = 0;
+		while (!(x & 1)) {
+			x >>= 1;
+			pos++;
+		}
+		return pos;
+	}
+#endif
+//64-bit version is composed of two 32-bit calls
+static AWH_INLINE uint32_t ctz(uint64_t x) {
+	uint32_t low = uint32_t(x);
+	return low ? ctz(low) : 32 + ctz(uint32_t(x >> 32));
+}
+
+//================================================================
+
+//checks whether values of given type can be copied with memcpy
+//note: without C++11 no type is considered trivially copyable
+#ifndef AWH_NO_CPP11
+	template<class Type> struct IsTriviallyCopyable {
+		static const bool value = std::is_trivially_copyable<Type>::value;
+	};
+#else
+	template<class Type> struct IsTriviallyCopyable {
+		static const bool value = false;
+	};
+#endif
+
+//checks whether values of given type are equal (operator ==) iff they are bitwise equal
+//true for integers, enums and pointers, but not for floating point types (NaN, signed zeros)
+//note: without C++11 no type is considered bitwise comparable
+#ifndef AWH_NO_CPP11
+	template<class Type> struct IsBitwiseComparable {
+		static const bool value = std::is_scalar<Type>::value && !std::is_floating_point<Type>::value;
+	};
+#else
+	template<class Type> struct IsBitwiseComparable {
+		static const bool value = false;
+	};
+#endif
+
+//checks whether destructor of given type does nothing
+//note: without C++11 no type is considered trivially destructible
+#ifndef AWH_NO_CPP11
+	template<class Type> struct IsTriviallyDestructible {
+		static const bool value = std::is_trivially_destructible<Type>::value;
+	};
+#else
+	template<class Type> struct IsTriviallyDestructible {
+		static const bool value = false;
+	};
+#endif
+
+//checks whether RELOCATE_WITH_SWAP flag is set in given value traits
+//the flag is optional: if it is missing, then it is considered to be false
+template<class Traits> class RelocateWithSwap {
+	template<bool FLAG> struct Probe {};
+	template<class T> static char Test(Probe<T::RELOCATE_WITH_SWAP> *);
+	template<class T> static long Test(...);
+	template<class T, bool PRESENT> struct Flag { static const bool value = false; };
+	template<class T> struct Flag<T, true> { static const bool value = T::RELOCATE_WITH_SWAP; };
+public:
+	static const bool value = Flag<Traits, sizeof(Test<Traits>(0)) == sizeof(char)>::value;
+};
+
+//moves value from src to dst, leaving src alive (in unspecified state)
+//general version: move (which is a copy without C++11)
+template<class Value, bool SWAP> struct ValueMover {
+	//dst is dead (not constructed) before the call
+	static AWH_INLINE void Construct(Value *dst, Value &src) {
+		new (dst) Value(AWH_MOVE(src));
+	}
+	//dst is alive before the call
+	static AWH_INLINE void Assign(Value &dst, Value &src) {
+		dst = AWH_MOVE(src);
+	}
+};
+//version for RELOCATE_WITH_SWAP: default-construct, then swap
+//it avoids deep copies of e.g. std::vector without C++11
+template<class Value> struct ValueMover<Value, true> {
+	static AWH_INLINE void Construct(Value *dst, Value &src) {
+		Value *res = new (dst) Value();
+		using std::swap;
+		swap(*res, src);
+	}
+	static AWH_INLINE void Assign(Value &dst, Value &src) {
+		using std::swap;
+		swap(dst, src);
+	}
+};
+
+//checks whether all bytes in representation of given object are equal
+//such object can be replicated with memset
+template<class Type> static AWH_INLINE bool IsByteUniform(const Type &object) {
+	const unsigned char *bytes = (const unsigned char*)&object;
+	for (size_t i = 1; i < sizeof(Type); i++)
+		if (bytes[i] != bytes[0])
+			return false;
+	return true;
+}
+
 //================================================================
 
 //end namespace
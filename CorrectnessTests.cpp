@@ -5,8 +5,28 @@
 
 #include "CorrectnessTests.h"
 #include "TestContainer.h"
+#include "ArrayWithHash_Dictionary.h"
+#include "ArrayWithHash_Small.h"
+#include "ArrayWithHash_SlotMap.h"
+#include "ArrayWithHash_Cache.h"
+#include "ArrayWithHash_Expiring.h"
+#include "ArrayWithHash_Multi.h"
+#include "ArrayWithHash_Composite.h"
+#include "ArrayWithHash_Spatial.h"
+#include "ArrayWithHash_Radix.h"
+#include "ArrayWithHash_Interner.h"
+#if __cplusplus >= 201402L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201402L)
+#define AWH_TEST_STATIC
+#include "ArrayWithHash_Static.h"
+#endif
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define AWH_TEST_CORO
+#include "ArrayWithHash_Coro.h"
+#endif
 
 #include <vector>
+#include <array>
+#include <map>
 #include <numeric>
 #include <cstring>
 #include <cinttypes>
@@ -34,6 +54,140 @@ template<> struct Getter<true> {
 	static void Do(Container &dict, Key key) { dict.Get(key); }
 };
 
+template<bool Enabled> struct Cloner {
+	template<class Container>
+	static void Do(Container &dict, Container &target) {}
+};
+template<> struct Cloner<true> {
+	template<class Container>
+	static void Do(Container &dict, Container &target) { dict.CloneTo(target); }
+};
+
+template<bool Enabled> struct Uniter {
+	template<class Container>
+	static void Do(Container &dict, Container &other) {}
+};
+template<> struct Uniter<true> {
+	template<class Container>
+	static void Do(Container &dict, Container &other) { dict.UniteWith(other); }
+};
+
+template<bool Enabled> struct Columns {
+	template<class Container, class Rnd>
+	static void Do(Container &dict, int64_t minKey, int64_t maxKey, Rnd &rnd) {}
+};
+template<> struct Columns<true> {
+	template<class Container, class Rnd>
+	static void Do(Container &dict, int64_t minKey, int64_t maxKey, Rnd &rnd) {
+		typedef typename Container::Key Key;
+		typedef typename Container::Value Value;
+		if (std::uniform_int_distribution<int>(0, 1)(rnd)) {
+			dict.ExportColumns(std::uniform_int_distribution<int>(0, 1)(rnd) != 0);
+			return;
+		}
+		int cnt = std::uniform_int_distribution<int>(0, 3)(rnd) ? std::uniform_int_distribution<int>(0, 30)(rnd) : 300;
+		std::vector<Key> keys(cnt + 1);
+		std::vector<Value> values(cnt + 1);
+		for (int i = 0; i < cnt; i++) {
+			keys[i] = (Key)std::uniform_int_distribution<int64_t>(minKey, maxKey)(rnd);
+			values[i] = ValueTestingUtils<Value>::Generate(rnd);
+		}
+		dict.ImportColumns(&keys[0], &values[0], cnt);
+	}
+};
+
+//operations supported only by containers with full interface
+template<bool Enabled> struct FullInterfaceOps {
+	template<class Container, class Rnd>
+	static void GetPtrBatch(Container &dict, int64_t minKey, int64_t maxKey, Rnd &rnd) {}
+	template<class Container, class Rnd>
+	static void SetAlgebra(Container &dict, int64_t minKey, int64_t maxKey, Rnd &rnd) {}
+	template<class Container, class Rnd>
+	static void Compare(Container &dict, int64_t minKey, int64_t maxKey, Rnd &rnd) {}
+	template<class Container, class Rnd>
+	static void Columnar(Container &dict, int64_t minKey, int64_t maxKey, Rnd &rnd) {}
+	template<class Container, class Rnd>
+	static void ForEachSorted(Container &dict, Rnd &rnd) {}
+	template<class Container, class Rnd>
+	static void Append(Container &dict, Rnd &rnd) {}
+	template<class Container>
+	static void Compact(Container &dict) {}
+};
+template<> struct FullInterfaceOps<true> {
+	template<class Container, class Rnd>
+	static void GetPtrBatch(Container &dict, int64_t minKey, int64_t maxKey, Rnd &rnd) {
+		typedef typename Container::Key Key;
+		std::vector<Key> keys(std::uniform_int_distribution<int>(0, 50)(rnd) + 1);
+		for (size_t i = 0; i < keys.size(); i++)
+			keys[i] = (Key)std::uniform_int_distribution<int64_t>(minKey, maxKey)(rnd);
+		dict.GetPtrBatch(&keys[0], keys.size() - 1);
+	}
+	template<class Container, class Rnd>
+	static void SetAlgebra(Container &dict, int64_t minKey, int64_t maxKey, Rnd &rnd) {
+		typedef typename Container::Key Key;
+		typedef typename Container::Value Value;
+		Container other;
+		other.assertLevel = dict.assertLevel;
+		int cnt = std::uniform_int_distribution<int>(0, 3)(rnd) ? std::uniform_int_distribution<int>(0, 30)(rnd) : 300;
+		for (int i = 0; i < cnt; i++) {
+			Key key = (Key)std::uniform_int_distribution<int64_t>(minKey, maxKey)(rnd);
+			other.Set(key, ValueTestingUtils<Value>::Generate(rnd));
+		}
+		int type = std::uniform_int_distribution<int>(0, 2)(rnd);
+		if (type == 0)
+			Uniter<std::is_copy_constructible<Value>::value>::Do(dict, other);
+		else if (type == 1)
+			dict.IntersectWith(other);
+		else
+			dict.Subtract(other);
+	}
+	template<class Container, class Rnd>
+	static void Compare(Container &dict, int64_t minKey, int64_t maxKey, Rnd &rnd) {
+		typedef typename Container::Key Key;
+		typedef typename Container::Value Value;
+		//make a copy (if possible) and apply a few changes to it
+		Container other;
+		other.assertLevel = dict.assertLevel;
+		Cloner<std::is_copy_constructible<Value>::value>::Do(dict, other);
+		int cnt = std::uniform_int_distribution<int>(0, 3)(rnd);
+		for (int i = 0; i < cnt; i++) {
+			Key key = (Key)std::uniform_int_distribution<int64_t>(minKey, maxKey)(rnd);
+			if (std::uniform_int_distribution<int>(0, 1)(rnd))
+				other.Set(key, ValueTestingUtils<Value>::Generate(rnd));
+			else
+				other.Remove(key);
+		}
+		dict.Equals(other);
+		other.Equals(dict);
+		dict.Diff(other);
+		other.Diff(dict);
+	}
+	template<class Container, class Rnd>
+	static void Columnar(Container &dict, int64_t minKey, int64_t maxKey, Rnd &rnd) {
+		typedef typename Container::Value Value;
+		Columns<std::is_copy_constructible<Value>::value>::Do(dict, minKey, maxKey, rnd);
+	}
+	template<class Container, class Rnd>
+	static void ForEachSorted(Container &dict, Rnd &rnd) {
+		int size = dict.GetSize();
+		//sometimes stop iteration in the middle
+		int stopAfter = std::uniform_int_distribution<int>(0, 3)(rnd) ? size + 1 : std::uniform_int_distribution<int>(0, size)(rnd);
+		dict.ForEachSorted(stopAfter);
+	}
+	template<class Container, class Rnd>
+	static void Append(Container &dict, Rnd &rnd) {
+		typedef typename Container::Value Value;
+		dict.Length();
+		int cnt = std::uniform_int_distribution<int>(0, 3)(rnd) ? std::uniform_int_distribution<int>(0, 3)(rnd) : 50;
+		for (int i = 0; i < cnt; i++)
+			dict.PushBack(ValueTestingUtils<Value>::Generate(rnd));
+	}
+	template<class Container>
+	static void Compact(Container &dict) {
+		dict.Compact();
+	}
+};
+
 template<class Container>
 void TestRandom(Container &dict, std::vector<double> typeProbs, int operationsCount, int64_t minKey, int64_t maxKey, std::mt19937 &rnd) {
 	double allSum = std::accumulate(typeProbs.begin(), typeProbs.end(), 0.0);
@@ -123,6 +277,36 @@ void TestRandom(Container &dict, std::vector<double> typeProbs, int operationsCo
 		else if (type == 10) {
 			dict.CalcCheckSum();
 		}
+		else if (type == 11) {
+			//Note: excluded from compilation for e.g. unique_ptr
+			Container tmp;
+			tmp.Set(7, ValueTestingUtils<Value>::Generate(rnd));
+			Cloner<std::is_copy_constructible<Value>::value>::Do(dict, tmp);
+			//continue working with the copy
+			dict.Swap(tmp);
+			dict.CalcCheckSum();
+		}
+		else if (type == 12) {
+			FullInterfaceOps<Container::FULL_INTERFACE>::GetPtrBatch(dict, minKey, maxKey, rnd);
+		}
+		else if (type == 13) {
+			FullInterfaceOps<Container::FULL_INTERFACE>::SetAlgebra(dict, minKey, maxKey, rnd);
+		}
+		else if (type == 14) {
+			FullInterfaceOps<Container::FULL_INTERFACE>::Compare(dict, minKey, maxKey, rnd);
+		}
+		else if (type == 15) {
+			FullInterfaceOps<Container::FULL_INTERFACE>::Columnar(dict, minKey, maxKey, rnd);
+		}
+		else if (type == 16) {
+			FullInterfaceOps<Container::FULL_INTERFACE>::ForEachSorted(dict, rnd);
+		}
+		else if (type == 17) {
+			FullInterfaceOps<Container::FULL_INTERFACE>::Append(dict, rnd);
+		}
+		else if (type == 18) {
+			FullInterfaceOps<Container::FULL_INTERFACE>::Compact(dict);
+		}
 
 		doneOps++;
 	}
@@ -132,6 +316,10 @@ void TestRandom(Container &dict, std::vector<double> typeProbs, int operationsCo
 	TestContainer<Key, Value> dict; \
 	sprintf(dict.label, "%s:%s", #Key, #Value);
 
+#define DECL_SMALL_CONTAINER(Key, Value, N) \
+	TestContainer<Key, Value, DefaultKeyTraits<Key>, DefaultValueTraits<Value>, SmallArrayWithHash<Key, Value, N>> dict; \
+	sprintf(dict.label, "small%d:%s:%s", N, #Key, #Value);
+
 void TestsRound_Int32(std::mt19937 &rnd) {
 	{
 		DECL_CONTAINER(int32_t, int32_t);
@@ -284,6 +472,944 @@ void TestsRound_String(std::mt19937 &rnd) {
 	}
 }
 
+//operations of full interface which were added after basic ones (cloning, set algebra, columns, etc.)
+//note: they are tested separately, so that tests of basic operations remain intact
+void TestsRound_Operations(std::mt19937 &rnd) {
+	{
+		DECL_CONTAINER(int32_t, int32_t);
+		TestRandom(dict, {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}, 1000, -100, 100, rnd);
+	}
+	{
+		DECL_CONTAINER(int32_t, int32_t);
+		TestRandom(dict, {1, 1, 1, 1, 1, 1, 1, 0.01, 0, 0, 0, 0.1, 0.1, 0.1, 0.1, 0.1, 0.1, 0.1, 0.1}, 1000, -2000000000, 2000000000, rnd);
+	}
+	{
+		DECL_CONTAINER(uint32_t, int32_t);
+		TestRandom(dict, {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}, 1000, 0, 100, rnd);
+	}
+	{
+		DECL_CONTAINER(int64_t, int32_t);
+		TestRandom(dict, {1, 1, 1, 1, 1, 1, 1, 0.01, 0.01, 0.01, 0.01, 0, 0, 0, 0, 0.1, 0.1, 0.1, 0.1}, 1000, -(1LL << 62) + 1, (1LL << 62) - 1, rnd);
+	}
+	{
+		DECL_CONTAINER(uint64_t, int32_t);
+		TestRandom(dict, {1, 1, 1, 1, 1, 1, 1, 0.01, 0.01, 0.01, 0.01, 0, 0, 0, 0, 0.1, 0.1, 0.1, 0.1}, 1000, 0ULL, (1ULL << 63) - 1, rnd);
+	}
+	{
+		DECL_CONTAINER(int32_t, double);
+		TestRandom(dict, {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}, 1000, -100, 100, rnd);
+	}
+	{
+		DECL_CONTAINER(int32_t, std::unique_ptr<int32_t>);
+		TestRandom(dict, {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 1, 1, 0, 1, 1, 1}, 1000, -100, 100, rnd);
+	}
+	{
+		DECL_CONTAINER(int32_t, std::shared_ptr<uint16_t>);
+		TestRandom(dict, {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}, 1000, -2000000000, 2000000000, rnd);
+	}
+	{
+		DECL_CONTAINER(int32_t, std::string);
+		TestRandom(dict, {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}, 1000, -2000000000, 2000000000, rnd);
+	}
+}
+
+void TestsRound_Small(std::mt19937 &rnd) {
+	{
+		DECL_SMALL_CONTAINER(int32_t, int32_t, 4);
+		TestRandom(dict, {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}, 1000, -5, 5, rnd);
+	}
+	{
+		DECL_SMALL_CONTAINER(int32_t, int32_t, 4);
+		TestRandom(dict, {1, 1, 1, 1, 1, 1, 1, 0.01, 0.01, 0.01, 0.01}, 1000, -100, 100, rnd);
+	}
+	{
+		DECL_SMALL_CONTAINER(int64_t, std::string, 3);
+		TestRandom(dict, {1, 1, 1, 1, 1, 3, 1, 0.01, 0.1, 0.1, 0.1}, 1000, -5, 5, rnd);
+	}
+	{
+		DECL_SMALL_CONTAINER(int32_t, std::unique_ptr<int32_t>, 2);
+		TestRandom(dict, {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}, 1000, -3, 3, rnd);
+	}
+}
+
+void TestsRound_Dictionary(std::mt19937 &rnd) {
+	if (!quietTests) {
+		printf("TestsRound_Dictionary\n");
+		fflush(stdout);
+	}
+	//few distinct strings over many keys, codes are 8-bit
+	DictionaryArrayWithHash<int32_t, std::string, uint8_t> dict;
+	std::map<int32_t, std::string> check;
+	for (int i = 0; i < 3000; i++) {
+		int32_t key = std::uniform_int_distribution<int32_t>(-100, 1000)(rnd);
+		int type = std::uniform_int_distribution<int>(0, 3)(rnd);
+		if (type <= 1) {
+			int idx = std::uniform_int_distribution<int>(0, 300)(rnd);
+			std::string value = "value" + std::to_string(idx);
+			const std::string *ptr = dict.Set(key, value);
+			if (ptr) {
+				AWH_ASSERT_ALWAYS(*ptr == value);
+				check[key] = value;
+			}
+			else
+				AWH_ASSERT_ALWAYS(dict.GetDictionarySize() == 255 && dict.FindCode(value) == dict.EMPTY_CODE);
+		}
+		else if (type == 2) {
+			dict.Remove(key);
+			check.erase(key);
+		}
+		else {
+			const std::string *ptr = dict.GetPtr(key);
+			auto it = check.find(key);
+			AWH_ASSERT_ALWAYS(!ptr == (it == check.end()));
+			if (ptr) {
+				AWH_ASSERT_ALWAYS(*ptr == it->second && dict.Get(key) == it->second);
+				AWH_ASSERT_ALWAYS(dict.Decode(dict.GetCode(key)) == it->second);
+			}
+		}
+		AWH_ASSERT_ALWAYS(dict.GetSize() == check.size());
+		dict.AssertCorrectness(assertLevel);
+	}
+	size_t visited = 0;
+	auto Check = [&](int32_t key, const std::string &value) -> bool {
+		AWH_ASSERT_ALWAYS(check.at(key) == value);
+		visited++;
+		return false;
+	};
+	dict.ForEach(Check);
+	AWH_ASSERT_ALWAYS(visited == check.size());
+	//codes of overwritten values are reused, so any number of distinct values can be set over time
+	dict.Clear();
+	AWH_ASSERT_ALWAYS(dict.GetSize() == 0 && dict.GetDictionarySize() == 0);
+	for (int i = 0; i < 3000; i++) {
+		std::string value = "value" + std::to_string(i);
+		AWH_ASSERT_ALWAYS(dict.Set(i % 100, value) && dict.Get(i % 100) == value);
+		//note: values encoded without use are freed when all codes are taken
+		if (i % 7 == 0)
+			dict.Encode("unused" + std::to_string(i));
+	}
+	AWH_ASSERT_ALWAYS(dict.GetSize() == 100);
+	dict.AssertCorrectness(assertLevel);
+}
+
+void TestsRound_SlotMap(std::mt19937 &rnd) {
+	if (!quietTests) {
+		printf("TestsRound_SlotMap\n");
+		fflush(stdout);
+	}
+	typedef SlotMapArrayWithHash<std::string> SlotMap;
+	SlotMap slots;
+	//all handles ever returned, and expected values for them (empty if removed)
+	std::vector<std::pair<SlotMap::Handle, std::string>> handles;
+	size_t alive = 0;
+	for (int i = 0; i < 5000; i++) {
+		int type = std::uniform_int_distribution<int>(0, 9)(rnd);
+		if (type <= 3 || handles.empty()) {
+			std::string value = "id" + std::to_string(i);
+			size_t idsCount = slots.GetIdsCount();
+			SlotMap::Handle handle = slots.Insert(value);
+			//freed IDs must be reused first, so IDs are always dense
+			AWH_ASSERT_ALWAYS(slots.GetIdsCount() == (alive < idsCount ? idsCount : idsCount + 1));
+			AWH_ASSERT_ALWAYS(handle.index < slots.GetIdsCount());
+			for (size_t j = 0; j < handles.size(); j++)
+				AWH_ASSERT_ALWAYS(handles[j].first != handle);
+			handles.push_back(std::make_pair(handle, value));
+			alive++;
+		}
+		else if (type <= 6) {
+			//remove element by some handle (possibly stale)
+			auto &elem = handles[std::uniform_int_distribution<size_t>(0, handles.size() - 1)(rnd)];
+			bool removed = slots.Remove(elem.first);
+			AWH_ASSERT_ALWAYS(removed == !elem.second.empty());
+			if (removed) {
+				elem.second.clear();
+				alive--;
+			}
+		}
+		else if (type <= 8) {
+			auto &elem = handles[std::uniform_int_distribution<size_t>(0, handles.size() - 1)(rnd)];
+			std::string *ptr = slots.GetPtr(elem.first);
+			AWH_ASSERT_ALWAYS(slots.IsValid(elem.first) == !elem.second.empty());
+			AWH_ASSERT_ALWAYS(ptr ? *ptr == elem.second : elem.second.empty());
+		}
+		else if (std::uniform_int_distribution<int>(0, 20)(rnd) == 0) {
+			slots.Clear();
+			for (size_t j = 0; j < handles.size(); j++)
+				handles[j].second.clear();
+			alive = 0;
+		}
+		AWH_ASSERT_ALWAYS(slots.GetSize() == alive);
+		AWH_ASSERT_ALWAYS(!slots.IsValid(SlotMap::NullHandle()));
+		slots.AssertCorrectness(assertLevel);
+	}
+	size_t visited = 0;
+	auto Check = [&](SlotMap::Handle handle, const std::string &value) -> bool {
+		AWH_ASSERT_ALWAYS(slots.GetPtr(handle) && *slots.GetPtr(handle) == value);
+		visited++;
+		return false;
+	};
+	slots.ForEach(Check);
+	AWH_ASSERT_ALWAYS(visited == alive);
+}
+
+void TestsRound_Cache(std::mt19937 &rnd) {
+	if (!quietTests) {
+		printf("TestsRound_Cache\n");
+		fflush(stdout);
+	}
+	typedef CacheArrayWithHash<int32_t, int64_t> Cache;
+	for (int iter = 0; iter < 20; iter++) {
+		int32_t capacity = std::uniform_int_distribution<int32_t>(1, 300)(rnd);
+		int32_t range = capacity * std::uniform_int_distribution<int32_t>(1, 4)(rnd);
+		bool sparse = (iter & 1);
+		Cache cache(capacity);
+		//latest values set for all keys (including evicted ones)
+		std::map<int32_t, int64_t> latest;
+		for (int i = 0; i < 3000; i++) {
+			int32_t key = std::uniform_int_distribution<int32_t>(0, range - 1)(rnd);
+			if (sparse)
+				key *= 1000003;
+			int type = std::uniform_int_distribution<int>(0, 9)(rnd);
+			if (type <= 4) {
+				int64_t value = std::uniform_int_distribution<int64_t>(0, 1000000)(rnd);
+				size_t oldSize = cache.GetSize();
+				bool present = cache.Peek(key) != NULL;
+				cache.Set(key, value);
+				latest[key] = value;
+				AWH_ASSERT_ALWAYS(cache.GetSize() == (present || oldSize == size_t(capacity) ? oldSize : oldSize + 1));
+				AWH_ASSERT_ALWAYS(*cache.Peek(key) == value);
+			}
+			else if (type <= 8) {
+				//element in cache must have the latest value set for it
+				int64_t *ptr = cache.GetPtr(key);
+				if (ptr)
+					AWH_ASSERT_ALWAYS(latest.count(key) && *ptr == latest[key]);
+			}
+			else {
+				cache.Remove(key);
+				AWH_ASSERT_ALWAYS(!cache.Peek(key));
+			}
+			cache.AssertCorrectness(assertLevel);
+		}
+		//fill cache and check second chance: element accessed just before insertion must survive
+		//note: at most half of the elements are referenced, so unreferenced victim always exists
+		cache.Clear();
+		for (int32_t k = 0; k < capacity; k++)
+			cache.Set(sparse ? k * 1000003 : k, k + 1);
+		for (int32_t j = 0; 2 * j < capacity - 1; j++) {
+			int32_t touched;
+			do {
+				touched = std::uniform_int_distribution<int32_t>(0, capacity + j - 1)(rnd);
+				if (sparse)
+					touched *= 1000003;
+			} while (!cache.GetPtr(touched));
+			int32_t added = capacity + j;
+			cache.Set(sparse ? added * 1000003 : added, added + 1);
+			AWH_ASSERT_ALWAYS(cache.GetSize() == size_t(capacity));
+			AWH_ASSERT_ALWAYS(cache.Peek(touched));
+			cache.AssertCorrectness(assertLevel);
+		}
+		//second chance must survive reallocation of underlying container
+		//note: inserted element is unreferenced, so eviction stops on it at the latest
+		for (int32_t j = 0; capacity >= 2 && j < 100; j++) {
+			cache.Remove(cache.GetValues().KeyOf(cache.GetValues().SampleRandom(rnd)));
+			int32_t touched = cache.GetValues().KeyOf(cache.GetValues().SampleRandom(rnd));
+			cache.GetPtr(touched);
+			for (int t = 0; t < 2; t++) {
+				int32_t added = 2 * capacity + 2 * j + t;
+				cache.Set(sparse ? added * 1000003 : added, added + 1);
+			}
+			AWH_ASSERT_ALWAYS(cache.Peek(touched));
+			cache.AssertCorrectness(assertLevel);
+		}
+	}
+}
+
+void TestsRound_Expiring(std::mt19937 &rnd) {
+	if (!quietTests) {
+		printf("TestsRound_Expiring\n");
+		fflush(stdout);
+	}
+	typedef ExpiringArrayWithHash<int32_t, std::string> Expiring;
+	typedef Expiring::Time Time;
+	for (int iter = 0; iter < 20; iter++) {
+		//note: start time is chosen to cross boundaries of upper levels of timing wheel soon
+		Time start = (iter & 1 ? Time(-1) - (Time(1) << 40) : 0) - std::uniform_int_distribution<Time>(0, 10000)(rnd);
+		Expiring container(start);
+		//key -> (value, expiry)
+		std::map<int32_t, std::pair<std::string, Time>> check;
+		int32_t range = std::uniform_int_distribution<int32_t>(10, 1000)(rnd);
+		//typical TTL: elements usually expire within the test
+		Time maxTtl = Time(1) << std::uniform_int_distribution<int>(0, 20)(rnd);
+		for (int i = 0; i < 3000; i++) {
+			int32_t key = std::uniform_int_distribution<int32_t>(0, range - 1)(rnd);
+			if (iter & 2)
+				key *= 1000003;
+			Time now = container.GetTime();
+			int type = std::uniform_int_distribution<int>(0, 9)(rnd);
+			if (type <= 3) {
+				std::string value = "v" + std::to_string(i);
+				Time ttl = std::min(std::uniform_int_distribution<Time>(0, maxTtl)(rnd), Time(-1) - now);
+				container.Set(key, value, ttl);
+				check[key] = std::make_pair(value, now + ttl);
+			}
+			else if (type <= 4) {
+				Time ttl = std::min(std::uniform_int_distribution<Time>(0, maxTtl)(rnd), Time(-1) - now);
+				bool present = container.SetTtl(key, ttl);
+				AWH_ASSERT_ALWAYS(present == (check.count(key) > 0));
+				if (present)
+					check[key].second = now + ttl;
+			}
+			else if (type <= 5) {
+				container.Remove(key);
+				check.erase(key);
+			}
+			else if (type <= 7) {
+				//advance by small delta, sometimes by huge one
+				Time delta = std::uniform_int_distribution<Time>(0, maxTtl / 8)(rnd);
+				if (std::uniform_int_distribution<int>(0, 30)(rnd) == 0)
+					delta = std::uniform_int_distribution<Time>(0, Time(1) << 45)(rnd);
+				Time target = now + std::min(delta, Time(-1) - now);
+				size_t expired = 0;
+				for (auto it = check.begin(); it != check.end(); ) {
+					if (it->second.second <= target) {
+						it = check.erase(it);
+						expired++;
+					}
+					else
+						++it;
+				}
+				AWH_ASSERT_ALWAYS(container.Advance(target) == expired);
+				AWH_ASSERT_ALWAYS(container.GetTime() == target);
+			}
+			else {
+				std::string *ptr = container.GetPtr(key);
+				auto it = check.find(key);
+				AWH_ASSERT_ALWAYS(ptr ? it != check.end() && *ptr == it->second.first : it == check.end());
+				if (ptr)
+					AWH_ASSERT_ALWAYS(container.GetExpiry(key) == it->second.second);
+			}
+			AWH_ASSERT_ALWAYS(container.GetSize() == check.size());
+			container.AssertCorrectness(assertLevel);
+		}
+		size_t visited = 0;
+		auto Check = [&](int32_t key, const std::string &value) -> bool {
+			AWH_ASSERT_ALWAYS(check.count(key) && check[key].first == value);
+			visited++;
+			return false;
+		};
+		container.ForEach(Check);
+		AWH_ASSERT_ALWAYS(visited == check.size());
+	}
+}
+
+void TestsRound_Sample(std::mt19937 &rnd) {
+	if (!quietTests) {
+		printf("TestsRound_Sample\n");
+		fflush(stdout);
+	}
+	for (int iter = 0; iter < 20; iter++) {
+		ArrayWithHash<int32_t, int32_t> container;
+		int32_t count = std::uniform_int_distribution<int32_t>(1, 40)(rnd);
+		std::vector<int32_t> keys;
+		for (int32_t i = 0; i < count; i++) {
+			//both dense keys (array part) and sparse keys (hash part)
+			int32_t key = (i % 3 ? i : i * 1000003);
+			container.Set(key, i);
+			keys.push_back(key);
+		}
+		//make fill ratio tiny sometimes, so that fallback scan is used
+		if (iter % 4 == 0)
+			container.Reserve(1 << 14, 1 << 14);
+		std::map<int32_t, int> hits;
+		int samples = count * 1000;
+		for (int s = 0; s < samples; s++) {
+			int32_t *ptr = container.SampleRandom(rnd);
+			AWH_ASSERT_ALWAYS(ptr && container.GetPtr(container.KeyOf(ptr)) == ptr);
+			hits[container.KeyOf(ptr)]++;
+		}
+		//each element must be sampled 1000 times on average: allow 6 sigmas deviation
+		AWH_ASSERT_ALWAYS(hits.size() == size_t(count));
+		for (size_t i = 0; i < keys.size(); i++)
+			AWH_ASSERT_ALWAYS(std::abs(hits[keys[i]] - 1000) < 6 * 32);
+	}
+	ArrayWithHash<int32_t, int32_t> empty;
+	AWH_ASSERT_ALWAYS(!empty.SampleRandom(rnd));
+}
+
+void TestsRound_Multi(std::mt19937 &rnd) {
+	if (!quietTests) {
+		printf("TestsRound_Multi\n");
+		fflush(stdout);
+	}
+	typedef MultiArrayWithHash<int32_t, std::string> Multi;
+	for (int iter = 0; iter < 10; iter++) {
+		Multi multi;
+		std::map<int32_t, std::vector<std::string>> check;
+		size_t total = 0;
+		int32_t range = std::uniform_int_distribution<int32_t>(1, 300)(rnd);
+		for (int i = 0; i < 5000; i++) {
+			int32_t key = std::uniform_int_distribution<int32_t>(0, range - 1)(rnd);
+			if (iter & 1)
+				key *= 1000003;
+			int type = std::uniform_int_distribution<int>(0, 19)(rnd);
+			if (type <= 11) {
+				std::string value = "v" + std::to_string(i);
+				std::string *ptr = multi.Append(key, value);
+				AWH_ASSERT_ALWAYS(*ptr == value);
+				check[key].push_back(value);
+				total++;
+			}
+			else if (type <= 12) {
+				size_t removed = multi.RemoveKey(key);
+				AWH_ASSERT_ALWAYS(removed == check[key].size());
+				total -= removed;
+				check.erase(key);
+			}
+			else if (type <= 17) {
+				//values of a key must be contiguous and in order of insertion
+				const std::vector<std::string> &expected = check[key];
+				size_t cnt;
+				std::string *values = multi.GetValues(key, cnt);
+				AWH_ASSERT_ALWAYS(multi.GetCount(key) == expected.size() && cnt == expected.size());
+				AWH_ASSERT_ALWAYS((values != NULL) == (cnt > 0));
+				for (size_t j = 0; j < cnt; j++)
+					AWH_ASSERT_ALWAYS(values[j] == expected[j]);
+				size_t limit = std::uniform_int_distribution<size_t>(1, expected.size() + 1)(rnd), visited = 0;
+				auto Check = [&](std::string &value) -> bool {
+					AWH_ASSERT_ALWAYS(value == expected[visited]);
+					return ++visited == limit;
+				};
+				multi.ForEachValue(key, Check);
+				AWH_ASSERT_ALWAYS(visited == std::min(limit, expected.size()));
+				if (expected.empty())
+					check.erase(key);
+			}
+			else if (type <= 18) {
+				multi.CompactArena();
+				AWH_ASSERT_ALWAYS(multi.GetArenaSize() == total);
+			}
+			else if (std::uniform_int_distribution<int>(0, 20)(rnd) == 0) {
+				multi.Clear();
+				check.clear();
+				total = 0;
+			}
+			AWH_ASSERT_ALWAYS(multi.GetSize() == total);
+			AWH_ASSERT_ALWAYS(multi.GetKeysCount() == check.size());
+			multi.AssertCorrectness(assertLevel);
+		}
+		//all pairs must be visited, values of each key go consecutively
+		std::map<int32_t, std::vector<std::string>> visited;
+		int32_t lastKey = 0;
+		auto Collect = [&](int32_t key, std::string &value) -> bool {
+			AWH_ASSERT_ALWAYS(visited.count(key) == 0 || key == lastKey);
+			visited[key].push_back(value);
+			lastKey = key;
+			return false;
+		};
+		multi.ForEach(Collect);
+		AWH_ASSERT_ALWAYS(visited == check);
+	}
+}
+
+void TestsRound_Composite(std::mt19937 &rnd) {
+	if (!quietTests) {
+		printf("TestsRound_Composite\n");
+		fflush(stdout);
+	}
+	typedef CompositeArrayWithHash<int32_t, int32_t, int64_t> Composite;
+	typedef std::map<std::pair<int32_t, int32_t>, int64_t> Check;
+	int32_t hiRange = 0, loRange = 0;
+	auto RandomKey = [&]() -> std::pair<int32_t, int32_t> {
+		int32_t hi = std::uniform_int_distribution<int32_t>(0, hiRange - 1)(rnd);
+		int32_t lo = std::uniform_int_distribution<int32_t>(0, loRange - 1)(rnd);
+		//some tenants have sparse IDs
+		if (hi % 4 == 3)
+			lo *= 1000003;
+		return std::make_pair(hi * 7919, lo);
+	};
+	auto Fill = [&](Composite &container, Check &check, int count) {
+		for (int i = 0; i < count; i++) {
+			std::pair<int32_t, int32_t> key = RandomKey();
+			int64_t value = std::uniform_int_distribution<int64_t>(0, 3)(rnd);
+			container.Set(key.first, key.second, value);
+			check[key] = value;
+		}
+	};
+	for (int iter = 0; iter < 20; iter++) {
+		hiRange = std::uniform_int_distribution<int32_t>(1, 20)(rnd);
+		loRange = std::uniform_int_distribution<int32_t>(1, 200)(rnd);
+		Composite container;
+		Check check;
+		for (int i = 0; i < 2000; i++) {
+			std::pair<int32_t, int32_t> key = RandomKey();
+			int32_t hi = key.first, lo = key.second;
+			int type = std::uniform_int_distribution<int>(0, 19)(rnd);
+			if (type <= 6) {
+				int64_t value = std::uniform_int_distribution<int64_t>(0, 1000000)(rnd);
+				AWH_ASSERT_ALWAYS(*container.Set(hi, lo, value) == value);
+				check[key] = value;
+			}
+			else if (type <= 8) {
+				int64_t value = std::uniform_int_distribution<int64_t>(0, 1000000)(rnd);
+				int64_t *ptr = container.SetIfNew(hi, lo, value);
+				auto res = check.insert(std::make_pair(key, value));
+				AWH_ASSERT_ALWAYS(res.second ? !ptr : ptr && *ptr == res.first->second);
+			}
+			else if (type <= 11) {
+				container.Remove(hi, lo);
+				check.erase(key);
+			}
+			else if (type <= 12) {
+				size_t removed = 0;
+				for (auto it = check.lower_bound(std::make_pair(hi, INT32_MIN)); it != check.end() && it->first.first == hi; removed++)
+					it = check.erase(it);
+				AWH_ASSERT_ALWAYS(container.RemoveGroup(hi) == removed);
+			}
+			else if (type <= 15) {
+				int64_t *ptr = container.GetPtr(hi, lo);
+				auto it = check.find(key);
+				AWH_ASSERT_ALWAYS(ptr ? it != check.end() && *ptr == it->second : it == check.end());
+				const Composite::Group *group = container.GetGroup(hi);
+				size_t groupSize = 0;
+				for (auto jt = check.lower_bound(std::make_pair(hi, INT32_MIN)); jt != check.end() && jt->first.first == hi; jt++)
+					groupSize++;
+				AWH_ASSERT_ALWAYS(group ? group->GetSize() == groupSize : groupSize == 0);
+			}
+			else if (type <= 18) {
+				//bulk operations with another random container
+				Composite other;
+				Check otherCheck;
+				Fill(other, otherCheck, std::uniform_int_distribution<int>(0, 50)(rnd));
+				int op = std::uniform_int_distribution<int>(0, 2)(rnd);
+				if (op == 0) {
+					container.UniteWith(other);
+					check.insert(otherCheck.begin(), otherCheck.end());
+				}
+				else if (op == 1) {
+					container.IntersectWith(other);
+					for (auto it = check.begin(); it != check.end(); )
+						it = (otherCheck.count(it->first) ? ++it : check.erase(it));
+				}
+				else {
+					container.Subtract(other);
+					for (auto it = otherCheck.begin(); it != otherCheck.end(); it++)
+						check.erase(it->first);
+				}
+				AWH_ASSERT_ALWAYS(other.Equals(other) && container.Equals(container));
+				AWH_ASSERT_ALWAYS(container.Equals(other) == (check == otherCheck));
+			}
+			else if (std::uniform_int_distribution<int>(0, 20)(rnd) == 0) {
+				container.Clear();
+				check.clear();
+			}
+			AWH_ASSERT_ALWAYS(container.GetSize() == check.size());
+			container.AssertCorrectness(assertLevel);
+		}
+		//iteration must go over all elements, and stop when requested
+		Check visited;
+		size_t limit = std::uniform_int_distribution<size_t>(1, check.size() + 1)(rnd);
+		auto Collect = [&](int32_t hi, int32_t lo, int64_t &value) -> bool {
+			visited[std::make_pair(hi, lo)] = value;
+			return visited.size() == limit;
+		};
+		container.ForEach(Collect);
+		AWH_ASSERT_ALWAYS(visited.size() == std::min(limit, check.size()));
+		for (auto it = visited.begin(); it != visited.end(); it++)
+			AWH_ASSERT_ALWAYS(check.count(it->first) && check[it->first] == it->second);
+	}
+}
+
+template<int DIMS> void TestSpatial(std::mt19937 &rnd) {
+	typedef SpatialArrayWithHash<int64_t, DIMS> Spatial;
+	typedef typename Spatial::Coord Coord;
+	typedef std::array<Coord, 3> Point;
+	//Morton codes must interleave bits of coordinates
+	for (int i = 0; i < 1000; i++) {
+		Point p = {{0, 0, 0}};
+		for (int d = 0; d < DIMS; d++)
+			p[d] = std::uniform_int_distribution<Coord>(0, Spatial::MAX_COORD - 1)(rnd);
+		uint64_t code = Spatial::Encode(p[0], p[1], p[2]), expected = 0;
+		for (int b = 0; b < Spatial::COORD_BITS; b++)
+			for (int d = 0; d < DIMS; d++)
+				expected |= uint64_t(p[d] >> b & 1) << (b * DIMS + d);
+		AWH_ASSERT_ALWAYS(code == expected);
+		Point q;
+		Spatial::Decode(code, q[0], q[1], q[2]);
+		AWH_ASSERT_ALWAYS(p == q);
+	}
+	for (int iter = 0; iter < 10; iter++) {
+		Spatial grid;
+		std::map<Point, int64_t> check;
+		//dense region near origin and a few far away points
+		Coord range = std::uniform_int_distribution<Coord>(1, DIMS == 2 ? 100 : 20)(rnd);
+		auto RandomPoint = [&]() -> Point {
+			Point p = {{0, 0, 0}};
+			bool far = std::uniform_int_distribution<int>(0, 9)(rnd) == 0;
+			for (int d = 0; d < DIMS; d++)
+				p[d] = std::uniform_int_distribution<Coord>(0, far ? Spatial::MAX_COORD - 1 : range - 1)(rnd);
+			return p;
+		};
+		for (int i = 0; i < 2000; i++) {
+			Point p = RandomPoint();
+			int type = std::uniform_int_distribution<int>(0, 9)(rnd);
+			if (type <= 4) {
+				int64_t value = std::uniform_int_distribution<int64_t>(0, 1000000)(rnd);
+				if (DIMS == 2)
+					grid.Set(p[0], p[1], value);
+				else
+					grid.Set(p[0], p[1], p[2], value);
+				check[p] = value;
+			}
+			else if (type <= 5) {
+				grid.Remove(p[0], p[1], p[2]);
+				check.erase(p);
+			}
+			else if (type <= 7) {
+				int64_t *ptr = grid.GetPtr(p[0], p[1], p[2]);
+				AWH_ASSERT_ALWAYS(ptr ? check.count(p) && *ptr == check[p] : !check.count(p));
+			}
+			else {
+				//box query (small or huge one), compared to brute force
+				Point boxMin = RandomPoint(), boxMax = RandomPoint();
+				for (int d = 0; d < DIMS; d++)
+					if (boxMin[d] > boxMax[d] && std::uniform_int_distribution<int>(0, 3)(rnd))
+						std::swap(boxMin[d], boxMax[d]);
+				Coord radius = std::uniform_int_distribution<Coord>(0, range)(rnd);
+				bool neighbor = (type == 9);
+				if (neighbor) {
+					for (int d = 0; d < DIMS; d++) {
+						boxMin[d] = (p[d] > radius ? p[d] - radius : 0);
+						boxMax[d] = std::min(p[d] + radius, Spatial::MAX_COORD - 1);
+					}
+				}
+				std::map<Point, int64_t> expected;
+				for (auto it = check.begin(); it != check.end(); it++) {
+					bool inside = true;
+					for (int d = 0; d < DIMS; d++)
+						inside &= (boxMin[d] <= it->first[d] && it->first[d] <= boxMax[d]);
+					if (inside)
+						expected.insert(*it);
+				}
+				std::map<Point, int64_t> visited;
+				uint64_t lastCode = 0;
+				bool sorted = true;
+				auto Collect = [&](Coord x, Coord y, Coord z, int64_t &value) -> bool {
+					Point q = {{x, y, z}};
+					AWH_ASSERT_ALWAYS(visited.count(q) == 0);
+					visited[q] = value;
+					uint64_t code = Spatial::Encode(x, y, z);
+					sorted &= (visited.size() == 1 || lastCode < code);
+					lastCode = code;
+					return false;
+				};
+				if (neighbor)
+					grid.ForEachNeighbor(p[0], p[1], p[2], radius, Collect);
+				else
+					grid.ForEachInBox(boxMin.data(), boxMax.data(), Collect);
+				AWH_ASSERT_ALWAYS(visited == expected);
+				//small boxes must be traversed in Z-order
+				double volume = 1.0;
+				for (int d = 0; d < DIMS; d++)
+					volume *= (boxMin[d] <= boxMax[d] ? double(boxMax[d] - boxMin[d] + 1) : 0.0);
+				if (volume <= double(grid.GetValues().GetCellsCount()))
+					AWH_ASSERT_ALWAYS(sorted);
+			}
+			AWH_ASSERT_ALWAYS(grid.GetSize() == check.size());
+			grid.AssertCorrectness(assertLevel);
+		}
+	}
+}
+void TestsRound_Spatial(std::mt19937 &rnd) {
+	if (!quietTests) {
+		printf("TestsRound_Spatial\n");
+		fflush(stdout);
+	}
+	TestSpatial<2>(rnd);
+	TestSpatial<3>(rnd);
+}
+
+template<class Key, int LEAF_BITS> void TestRadix(std::mt19937 &rnd) {
+	typedef RadixArrayWithHash<Key, std::string, LEAF_BITS> Radix;
+	typedef typename std::make_unsigned<Key>::type UKey;
+	for (int iter = 0; iter < 10; iter++) {
+		Radix radix;
+		std::map<UKey, std::string> check;
+		//keys are taken from a few dense regions scattered over the whole range
+		std::vector<UKey> regions;
+		int regionsCount = std::uniform_int_distribution<int>(1, 30)(rnd);
+		for (int i = 0; i < regionsCount; i++)
+			regions.push_back(std::uniform_int_distribution<UKey>(0, UKey(-1) - 1000)(rnd));
+		UKey width = std::uniform_int_distribution<UKey>(1, 1000)(rnd);
+		for (int i = 0; i < 3000; i++) {
+			UKey ukey = regions[std::uniform_int_distribution<size_t>(0, regions.size() - 1)(rnd)];
+			ukey += std::uniform_int_distribution<UKey>(0, width - 1)(rnd);
+			Key key = Key(ukey);
+			int type = std::uniform_int_distribution<int>(0, 9)(rnd);
+			if (type <= 3) {
+				std::string value = "v" + std::to_string(i);
+				AWH_ASSERT_ALWAYS(*radix.Set(key, value) == value);
+				check[ukey] = value;
+			}
+			else if (type <= 4) {
+				std::string value = "w" + std::to_string(i);
+				std::string *ptr = radix.SetIfNew(key, value);
+				auto res = check.insert(std::make_pair(ukey, value));
+				AWH_ASSERT_ALWAYS(res.second ? !ptr : ptr && *ptr == res.first->second);
+			}
+			else if (type <= 6) {
+				radix.Remove(key);
+				check.erase(ukey);
+			}
+			else {
+				std::string *ptr = radix.GetPtr(key);
+				auto it = check.find(ukey);
+				AWH_ASSERT_ALWAYS(ptr ? it != check.end() && *ptr == it->second : it == check.end());
+				AWH_ASSERT_ALWAYS(radix.Get(key) == (ptr ? *ptr : std::string()));
+			}
+			AWH_ASSERT_ALWAYS(radix.GetSize() == check.size());
+			radix.AssertCorrectness(assertLevel);
+		}
+		//sorted traversal must give exactly the same sequence as std::map (with unsigned keys)
+		std::vector<std::pair<UKey, std::string>> sorted;
+		auto Collect = [&](Key key, std::string &value) -> bool {
+			sorted.push_back(std::make_pair(UKey(key), value));
+			return false;
+		};
+		radix.ForEachSorted(Collect);
+		AWH_ASSERT_ALWAYS((sorted == std::vector<std::pair<UKey, std::string>>(check.begin(), check.end())));
+		size_t visited = 0;
+		auto Count = [&](Key key, std::string &value) -> bool {
+			AWH_ASSERT_ALWAYS(check[UKey(key)] == value);
+			return ++visited == 10;
+		};
+		radix.ForEach(Count);
+		AWH_ASSERT_ALWAYS(visited == std::min(check.size(), size_t(10)));
+	}
+}
+void TestsRound_Radix(std::mt19937 &rnd) {
+	if (!quietTests) {
+		printf("TestsRound_Radix\n");
+		fflush(stdout);
+	}
+	TestRadix<uint64_t, 8>(rnd);
+	TestRadix<int64_t, 4>(rnd);
+	TestRadix<int32_t, 6>(rnd);
+	TestRadix<uint32_t, 1>(rnd);
+}
+
+void TestsRound_Interner(std::mt19937 &rnd) {
+	if (!quietTests) {
+		printf("TestsRound_Interner\n");
+		fflush(stdout);
+	}
+	typedef StringInterner<uint32_t> Interner;
+	for (int iter = 0; iter < 10; iter++) {
+		Interner interner;
+		std::map<std::string, uint32_t> check;
+		std::vector<std::string> byId;
+		//vocabulary: short strings (some of them with zero chars), sometimes very long ones
+		int vocabulary = std::uniform_int_distribution<int>(1, 3000)(rnd);
+		auto RandomString = [&]() -> std::string {
+			int num = std::uniform_int_distribution<int>(0, vocabulary - 1)(rnd);
+			std::string res = "s" + std::to_string(num);
+			if (num % 7 == 0)
+				res += std::string(1, '\0') + "z";
+			if (num % 101 == 0)
+				res += std::string(Interner::CHUNK_SIZE / 3 + num, 'x');
+			if (num == 1)
+				res.clear();
+			return res;
+		};
+		for (int i = 0; i < 5000; i++) {
+			std::string str = RandomString();
+			int type = std::uniform_int_distribution<int>(0, 9)(rnd);
+			if (type <= 5) {
+				uint32_t id = interner.Intern(str);
+				if (check.count(str)) {
+					AWH_ASSERT_ALWAYS(check[str] == id);
+				}
+				else {
+					//new IDs are sequential
+					AWH_ASSERT_ALWAYS(id == byId.size());
+					check[str] = id;
+					byId.push_back(str);
+				}
+			}
+			else if (type <= 7) {
+				uint32_t id = interner.Find(str);
+				AWH_ASSERT_ALWAYS(check.count(str) ? id == check[str] : id == Interner::NO_ID);
+			}
+			else if (type <= 8) {
+				if (byId.empty())
+					continue;
+				uint32_t id = std::uniform_int_distribution<uint32_t>(0, uint32_t(byId.size() - 1))(rnd);
+				AWH_ASSERT_ALWAYS(std::string(interner.GetString(id), interner.GetLength(id)) == byId[id]);
+				AWH_ASSERT_ALWAYS(interner.GetString(id)[byId[id].size()] == 0);
+			}
+			else if (std::uniform_int_distribution<int>(0, 50)(rnd) == 0) {
+				interner.Clear();
+				check.clear();
+				byId.clear();
+			}
+			AWH_ASSERT_ALWAYS(interner.GetSize() == byId.size());
+			if (i % 100 == 0)
+				interner.AssertCorrectness(assertLevel);
+		}
+		interner.AssertCorrectness(assertLevel);
+	}
+}
+
+template<class Word> void TestSimdKernels(std::mt19937 &rnd) {
+	typedef SimdKernels<Word> Kernels;
+	const Word emptyKey = Word(DefaultKeyTraits<Word>::EMPTY_KEY);
+	const Word removedKey = Word(DefaultKeyTraits<Word>::REMOVED_KEY);
+	static const size_t BLOCKS = 3;
+	Word keys[BLOCKS * SIMD_BLOCK + 1];
+	for (int iter = 0; iter < 1000; iter++) {
+		//note: unaligned block is checked too
+		Word *block = keys + (iter & 1);
+		for (size_t i = 0; i < BLOCKS * SIMD_BLOCK; i++) {
+			int type = std::uniform_int_distribution<int>(0, 5)(rnd);
+			if (type == 0)
+				block[i] = emptyKey;
+			else if (type == 1)
+				block[i] = removedKey;
+			else if (type == 2)
+				block[i] = Word(emptyKey + 1);
+			else if (type == 3)	//keys of all lengths
+				block[i] = Word(std::uniform_int_distribution<uint64_t>()(rnd) >> std::uniform_int_distribution<int>(0, 63)(rnd));
+			else
+				block[i] = Word(std::uniform_int_distribution<uint64_t>()(rnd));
+		}
+
+		uint64_t expectedHisto[SIMD_HISTO_SIZE] = {0};
+		Kernels::GetLogHisto(SIMD_SCALAR)(block, BLOCKS * SIMD_BLOCK, emptyKey, removedKey, expectedHisto);
+		uint64_t total = 0;
+		for (size_t t = 0; t < SIMD_HISTO_SIZE; t++)
+			total += expectedHisto[t];
+		AWH_ASSERT_ALWAYS(total == BLOCKS * SIMD_BLOCK - std::count(block, block + BLOCKS * SIMD_BLOCK, emptyKey) - std::count(block, block + BLOCKS * SIMD_BLOCK, removedKey));
+		for (int level = SIMD_SCALAR; level <= GetSimdLevel() + 1; level++) {
+			typename Kernels::LogHistoFunc func = (level <= GetSimdLevel() ? Kernels::GetLogHisto(SimdLevel(level)) : Kernels::LogHisto());
+			if (!func)
+				continue;
+			uint64_t histo[SIMD_HISTO_SIZE] = {0};
+			func(block, BLOCKS * SIMD_BLOCK, emptyKey, removedKey, histo);
+			AWH_ASSERT_ALWAYS(std::equal(histo, histo + SIMD_HISTO_SIZE, expectedHisto));
+		}
+		uint32_t expected = Kernels::GetValidMask(SIMD_SCALAR)(block, emptyKey, removedKey);
+		//all kernels supported by current CPU must give the same answer as scalar one
+		for (int level = SIMD_SCALAR; level <= GetSimdLevel(); level++)
+			if (typename Kernels::ValidMaskFunc func = Kernels::GetValidMask(SimdLevel(level)))
+				AWH_ASSERT_ALWAYS(func(block, emptyKey, removedKey) == expected);
+		AWH_ASSERT_ALWAYS(Kernels::ValidMask()(block, emptyKey, removedKey) == expected);
+	}
+}
+
+void TestsRound_Simd(std::mt19937 &rnd) {
+	if (!quietTests) {
+		printf("TestsRound_Simd (level %d)\n", int(GetSimdLevel()));
+		fflush(stdout);
+	}
+	TestSimdKernels<uint32_t>(rnd);
+	TestSimdKernels<uint64_t>(rnd);
+	TestSimdKernels<uint16_t>(rnd);
+}
+
+#ifdef AWH_TEST_STATIC
+typedef int (*StaticHandler)();
+static int StaticOpNop() { return 0; }
+static int StaticOpLoad() { return 1; }
+static int StaticOpJump() { return 2; }
+static int StaticOpHalt() { return 3; }
+constexpr StaticElement<int32_t, StaticHandler> StaticOpcodes[] = {
+	{0, &StaticOpNop}, {1, &StaticOpLoad}, {2, &StaticOpNop}, {5, &StaticOpJump},
+	{-7, &StaticOpHalt}, {100000, &StaticOpJump}, {2, &StaticOpLoad}
+};
+constexpr AWH_STATIC_TABLE_TYPE(StaticOpcodes) StaticOpcodesTable(StaticOpcodes);
+//lookups can be evaluated at compile time
+static_assert(StaticOpcodesTable.GetSize() == 6, "static table size");
+static_assert(StaticOpcodesTable.Get(-7) == &StaticOpHalt, "static table hash lookup");
+static_assert(StaticOpcodesTable.Get(2) == &StaticOpLoad, "static table array lookup");
+static_assert(StaticOpcodesTable.Get(3) == nullptr && StaticOpcodesTable.Get(99) == nullptr, "static table missing key");
+
+void TestsRound_Static(std::mt19937 &rnd) {
+	if (!quietTests) {
+		printf("TestsRound_Static\n");
+		fflush(stdout);
+	}
+	//compare against runtime container
+	ArrayWithHash<int32_t, StaticHandler> check;
+	for (size_t i = 0; i < sizeof(StaticOpcodes) / sizeof(StaticOpcodes[0]); i++)
+		check.Set(StaticOpcodes[i].key, StaticOpcodes[i].value);
+	for (int32_t key = -10; key <= 100010; key++) {
+		const StaticHandler *ptr = StaticOpcodesTable.GetPtr(key);
+		StaticHandler *ptrCheck = check.GetPtr(key);
+		AWH_ASSERT_ALWAYS(!ptr == !ptrCheck);
+		AWH_ASSERT_ALWAYS(!ptr || *ptr == *ptrCheck);
+	}
+	int visited = 0;
+	auto Check = [&](int32_t key, const StaticHandler &value) -> bool {
+		AWH_ASSERT_ALWAYS(check.Get(key) == value);
+		visited++;
+		return false;
+	};
+	StaticOpcodesTable.ForEach(Check);
+	AWH_ASSERT_ALWAYS(visited == 6);
+}
+#endif
+
+#ifdef AWH_TEST_CORO
+void TestsRound_Coro(std::mt19937 &rnd) {
+	if (!quietTests) {
+		printf("TestsRound_Coro\n");
+		fflush(stdout);
+	}
+	for (int iter = 0; iter < 20; iter++) {
+		//random links: key -> next key (chain ends on missing key)
+		ArrayWithHash<int32_t, int32_t> links;
+		int range = std::uniform_int_distribution<int>(0, 1)(rnd) ? 1000 : 2000000000;
+		int cnt = std::uniform_int_distribution<int>(0, 500)(rnd);
+		for (int i = 0; i < cnt; i++) {
+			int32_t key = std::uniform_int_distribution<int32_t>(-range, range)(rnd);
+			int32_t next = std::uniform_int_distribution<int32_t>(-range, range)(rnd);
+			links.Set(key, next);
+		}
+		std::vector<int32_t> starts(std::uniform_int_distribution<int>(0, 100)(rnd));
+		for (size_t i = 0; i < starts.size(); i++)
+			starts[i] = std::uniform_int_distribution<int32_t>(-range, range)(rnd);
+		int depth = std::uniform_int_distribution<int>(0, 10)(rnd);
+		//follow chains sequentially
+		std::vector<int32_t> expected(starts.size());
+		for (size_t i = 0; i < starts.size(); i++) {
+			int32_t key = starts[i];
+			for (int d = 0; d < depth; d++) {
+				int32_t *next = links.GetPtr(key);
+				if (!next)
+					break;
+				key = *next;
+			}
+			expected[i] = key;
+		}
+		//follow chains with interleaved coroutines
+		std::vector<int32_t> ends(starts.size(), 0);
+		auto chase = [&](size_t i) -> LookupTask {
+			int32_t key = starts[i];
+			for (int d = 0; d < depth; d++) {
+				int32_t *next = co_await AsyncGetPtr(links, key);
+				if (!next)
+					break;
+				key = *next;
+			}
+			ends[i] = key;
+		};
+		size_t inflight = std::uniform_int_distribution<size_t>(1, 20)(rnd);
+		RunInterleaved(starts.size(), chase, inflight);
+		AWH_ASSERT_ALWAYS(ends == expected);
+	}
+}
+#endif
+
 void TestsRound(std::mt19937 &rnd) {
 	TestsRound_Int32(rnd);
 	TestsRound_Keys(rnd);
@@ -292,4 +1418,23 @@ void TestsRound(std::mt19937 &rnd) {
 	TestsRound_UniquePtr(rnd);
 	TestsRound_SharedPtr(rnd);
 	TestsRound_String(rnd);
+	TestsRound_Operations(rnd);
+	TestsRound_Small(rnd);
+	TestsRound_Dictionary(rnd);
+	TestsRound_SlotMap(rnd);
+	TestsRound_Cache(rnd);
+	TestsRound_Expiring(rnd);
+	TestsRound_Sample(rnd);
+	TestsRound_Multi(rnd);
+	TestsRound_Composite(rnd);
+	TestsRound_Spatial(rnd);
+	TestsRound_Radix(rnd);
+	TestsRound_Interner(rnd);
+	TestsRound_Simd(rnd);
+#ifdef AWH_TEST_STATIC
+	TestsRound_Static(rnd);
+#endif
+#ifdef AWH_TEST_CORO
+	TestsRound_Coro(rnd);
+#endif
 }
@@ -5,6 +5,7 @@
 
 #define AWH_NO_CPP11
 #include "ArrayWithHash.h"
+#include "ArrayWithHash_Small.h"
 #include "StdMapWrapper.h"
 
 struct KeyTraits {
@@ -32,8 +33,30 @@ struct ValueTraits {
 	static const bool RELOCATE_WITH_MEMCPY = true;
 };
 
+//value with expensive copying (counted), but with cheap swap
+struct Payload {
+	static int copies;
+	std::vector<int32_t> data;
+	Payload() {}
+	explicit Payload(int32_t x) : data(100, x) {}
+	Payload(const Payload &other) : data(other.data) { copies++; }
+	Payload &operator= (const Payload &other) { data = other.data; copies++; return *this; }
+};
+int Payload::copies = 0;
+inline void swap(Payload &a, Payload &b) { a.data.swap(b.data); }
+
+struct PayloadTraits {
+	typedef Payload Value;
+	static inline bool IsEmpty(const Payload &value) { return value.data.empty(); }
+	static inline Value GetEmpty() { return Payload(); }
+	static const bool RELOCATE_WITH_MEMCPY = false;
+	//values are moved by swapping instead of copying
+	static const bool RELOCATE_WITH_SWAP = true;
+};
+
 typedef Awh::ArrayWithHash<int32_t, int32_t, KeyTraits, ValueTraits> TArrayWithHash;
 typedef Awh::StdMapWrapper<int32_t, int32_t, KeyTraits, ValueTraits> TStdMapWrapper;
+typedef Awh::SmallArrayWithHash<int32_t, int32_t, 4, KeyTraits, ValueTraits> TSmallArrayWithHash;
 
 struct SummatorAction {
 	int32_t sum;
@@ -97,8 +120,25 @@ template<class Container> void RunTest() {
 	printf("%d\n", dict.GetSize());
 }
 
+void RunSwapTest() {
+	Awh::ArrayWithHash<int32_t, Payload, KeyTraits, PayloadTraits> dict;
+	Payload::copies = 0;
+	//note: both parts are reallocated many times
+	for (int i = 0; i < 1000; i++) {
+		dict.Set(i % 2 ? i : i * 1000, Payload(i));
+		dict.SetIfNew(i * 7, Payload(i));
+	}
+	int64_t sum = 0;
+	for (int i = 0; i < 7000; i++)
+		if (Payload *ptr = dict.GetPtr(i))
+			sum += ptr->data[0] + ptr->data.size();
+	printf("%d %d %d\n", dict.GetSize(), int(sum), Payload::copies);
+}
+
 int main() {
 	RunTest<TArrayWithHash>();
 	RunTest<TStdMapWrapper>();
+	RunTest<TSmallArrayWithHash>();
+	RunSwapTest();
 	return 0;
 }
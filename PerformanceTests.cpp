@@ -75,6 +75,14 @@ void SpeedAll(bool compareToStl) {
 	TIME_CALL(GetPtrArrayRandomMix   , (100000, 100), (100000, 1000));
 	TIME_CALL(SetArrayRandomMix      , (100000, 100), (100000, 1000));
 	TIME_CALL(SetIfNewArrayRandomMix , (100000, 100), (100000, 1000));
+																																 
+	TIME_CALL(CloneArray             , (100000, 100), (100000, 1000));
+	TIME_CALL(CloneHash              , (100000, 100), (100000, 1000));
+	TIME_CALL(EqualsArray            , (100000, 100), (100000, 1000));
+	TIME_CALL(EqualsHash             , (100000, 100), (100000, 100));
+	TIME_CALL(ExportColumnsArray     , (100000, 100), (100000, 1000));
+	TIME_CALL(ForEachHashSparse      , (100000, 100), (100000, 100));
+	TIME_CALL(ForEachSortedHash      , (100000, 100), (100000, 100));
 
 	//print a well-aligned table to stdout
 	std::vector<size_t> width(table[0].size(), 0);
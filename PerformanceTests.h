@@ -116,7 +116,7 @@ template<class Container> double Speed_GetArrayRandomHit(int size, int repeats)
 		int sum = 0;
 		for (int j = 0; j < size; j++)
 			sum += cont.Get(keys[j]);
-		tmp += sum;
+		tmp = tmp + sum;
 	}
 
 	return my_clock() - start;
@@ -140,7 +140,7 @@ template<class Container> double Speed_GetArrayRandomMiss(int size, int repeats)
 		int sum = 0;
 		for (int j = 0; j < size; j++)
 			sum += cont.Get(keys[j]);
-		tmp += sum;
+		tmp = tmp + sum;
 	}
 
 	return my_clock() - start;
@@ -161,7 +161,7 @@ template<class Container> double Speed_GetArrayRandomMix(int size, int repeats)
 		int sum = 0;
 		for (int j = 0; j < size; j++)
 			sum += cont.Get(keys[j]);
-		tmp += sum;
+		tmp = tmp + sum;
 	}
 
 	return my_clock() - start;
@@ -182,7 +182,7 @@ template<class Container> double Speed_GetHashRandomHit(int size, int repeats) {
 		int sum = 0;
 		for (int j = 0; j < size; j++)
 			sum += cont.Get(keys[j]);
-		tmp += sum;
+		tmp = tmp + sum;
 	}
 
 	return my_clock() - start;
@@ -203,7 +203,7 @@ template<class Container> double Speed_GetHashRandomMiss(int size, int repeats)
 		int sum = 0;
 		for (int j = 0; j < size; j++)
 			sum += cont.Get(keys[j]);
-		tmp += sum;
+		tmp = tmp + sum;
 	}
 
 	return my_clock() - start;
@@ -242,7 +242,7 @@ template<class Container> double Speed_GetPtrArrayRandomMix(int size, int repeat
 		size_t sum = 0;
 		for (int j = 0; j < size; j++)
 			sum ^= (size_t)cont.GetPtr(keys[j]);
-		tmp += sum;
+		tmp = tmp + sum;
 	}
 
 	return my_clock() - start;
@@ -289,3 +289,128 @@ template<class Container> double Speed_SetIfNewArrayRandomMix(int size, int repe
 
 	return my_clock() - start;
 }
+
+template<class Container> double Speed_CloneArray(int size, int repeats) {
+	Container cont;
+	for (int i = 0; i < size; i++)
+		cont.Set(i, i*2);
+	double start = my_clock();
+
+	for (int i = 0; i < repeats; i++) {
+		Container copy;
+		cont.CloneTo(copy);
+	}
+
+	return my_clock() - start;
+}
+
+template<class Container> double Speed_CloneHash(int size, int repeats) {
+	std::mt19937 rnd;
+	Container cont;
+	for (int i = 0; i < size; i++) {
+		int key = std::uniform_int_distribution<int>(-2000000000, 2000000000)(rnd);
+		cont.Set(key, key + 1);
+	}
+	double start = my_clock();
+
+	for (int i = 0; i < repeats; i++) {
+		Container copy;
+		cont.CloneTo(copy);
+	}
+
+	return my_clock() - start;
+}
+
+template<class Container> double Speed_EqualsArray(int size, int repeats) {
+	Container a, b;
+	for (int i = 0; i < size; i++) {
+		a.Set(i, i*2);
+		b.Set(i, i*2);
+	}
+	double start = my_clock();
+
+	volatile int tmp = 0;
+	for (int i = 0; i < repeats; i++)
+		tmp = tmp + a.Equals(b);
+
+	return my_clock() - start;
+}
+
+template<class Container> double Speed_EqualsHash(int size, int repeats) {
+	std::mt19937 rnd;
+	Container a, b;
+	for (int i = 0; i < size; i++) {
+		int key = std::uniform_int_distribution<int>(-2000000000, 2000000000)(rnd);
+		a.Set(key, key + 1);
+		b.Set(key, key + 1);
+	}
+	double start = my_clock();
+
+	volatile int tmp = 0;
+	for (int i = 0; i < repeats; i++)
+		tmp = tmp + a.Equals(b);
+
+	return my_clock() - start;
+}
+
+template<class Container> double Speed_ExportColumnsArray(int size, int repeats) {
+	Container cont;
+	for (int i = 0; i < size; i++)
+		if (i % 4)
+			cont.Set(i, i*2);
+	std::vector<int> keys(size), values(size);
+	double start = my_clock();
+
+	for (int i = 0; i < repeats; i++)
+		cont.ExportColumns(&keys[0], &values[0]);
+
+	return my_clock() - start;
+}
+
+struct SumAction {
+	int sum;
+	template<class Key, class Value> bool operator() (Key key, Value &value) {
+		sum += key ^ value;
+		return false;
+	}
+};
+
+template<class Container> double Speed_ForEachHashSparse(int size, int repeats) {
+	std::mt19937 rnd;
+	Container cont;
+	//hash table is filled by 5% only
+	cont.Reserve(0, size * 20);
+	for (int i = 0; i < size; i++) {
+		int key = std::uniform_int_distribution<int>(-2000000000, 2000000000)(rnd);
+		cont.Set(key, key + 1);
+	}
+	double start = my_clock();
+
+	volatile int tmp = 0;
+	for (int i = 0; i < repeats; i++) {
+		SumAction action = {0};
+		cont.ForEach(action);
+		tmp = tmp + action.sum;
+	}
+
+	return my_clock() - start;
+}
+
+template<class Container> double Speed_ForEachSortedHash(int size, int repeats) {
+	std::mt19937 rnd;
+	Container cont;
+	for (int i = 0; i < size; i++) {
+		int key = std::uniform_int_distribution<int>(-2000000000, 2000000000)(rnd);
+		cont.Set(key, key + 1);
+	}
+	double start = my_clock();
+
+	volatile int tmp = 0;
+	for (int i = 0; i < repeats; i++) {
+		SumAction action = {0};
+		cont.ForEachSorted(action);
+		tmp = tmp + action.sum;
+	}
+
+	return my_clock() - start;
+}
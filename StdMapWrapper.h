@@ -6,6 +6,7 @@
 #pragma once
 
 #include <algorithm>
+#include <vector>
 
 #ifndef AWH_NO_CPP11
 #include <unordered_map>
@@ -69,6 +70,9 @@ public:
 	inline void Clear() {
 		dict.clear();
 	}
+	inline void CloneTo(StdMapWrapper &target) const {
+		target.dict = dict;
+	}
 	inline Size GetSize() const {
 		return (Size)dict.size();
 	}
@@ -97,6 +101,78 @@ public:
 	inline Key KeyOf(Ptr ptr) const {
 		return ptr.it->first;
 	}
+	Size Length() const {
+		Size res = 0;
+		while (dict.count(Key(res)))
+			res++;
+		return res;
+	}
+	Key PushBack(Value value) {
+		Key key = Key(Length());
+		dict.insert(std::make_pair(key, AWH_MOVE(value)));
+		return key;
+	}
+	inline void Prefetch(Key key) const {}
+	void GetPtrBatch(const Key *keys, Size count, Ptr *results) const {
+		for (Size i = 0; i < count; i++)
+			results[i] = GetPtr(keys[i]);
+	}
+	void UniteWith(const StdMapWrapper &other) {
+		for (Iter it = const_cast<Map&>(other.dict).begin(); it != const_cast<Map&>(other.dict).end(); it++)
+			dict.insert(*it);
+	}
+	void IntersectWith(const StdMapWrapper &other) {
+		for (Iter it = dict.begin(); it != dict.end(); )
+			if (other.dict.count(it->first) == 0)
+				dict.erase(it++);
+			else
+				it++;
+	}
+	void Subtract(const StdMapWrapper &other) {
+		for (Iter it = dict.begin(); it != dict.end(); )
+			if (other.dict.count(it->first) != 0)
+				dict.erase(it++);
+			else
+				it++;
+	}
+	bool Equals(const StdMapWrapper &other) const {
+		if (dict.size() != other.dict.size())
+			return false;
+		for (Iter it = const_cast<Map&>(dict).begin(); it != const_cast<Map&>(dict).end(); it++) {
+			typename Map::const_iterator jt = other.dict.find(it->first);
+			if (jt == other.dict.end() || !(it->second == jt->second))
+				return false;
+		}
+		return true;
+	}
+	template<class Added, class Removed, class Changed>
+	void Diff(const StdMapWrapper &newer, Added &onAdded, Removed &onRemoved, Changed &onChanged) const {
+		Map &newDict = const_cast<Map&>(newer.dict);
+		for (Iter it = const_cast<Map&>(dict).begin(); it != const_cast<Map&>(dict).end(); it++) {
+			Iter jt = newDict.find(it->first);
+			if (jt == newDict.end())
+				onRemoved(Key(it->first), it->second);
+			else if (!(it->second == jt->second))
+				onChanged(Key(it->first), it->second, jt->second);
+		}
+		for (Iter jt = newDict.begin(); jt != newDict.end(); jt++)
+			if (dict.count(jt->first) == 0)
+				onAdded(Key(jt->first), jt->second);
+	}
+	Size ExportColumns(Key *keys, Value *values, bool sorted = false) const {
+		std::vector<std::pair<Key, Value> > elems(dict.begin(), dict.end());
+		if (sorted)
+			std::sort(elems.begin(), elems.end());
+		for (size_t i = 0; i < elems.size(); i++) {
+			keys[i] = elems[i].first;
+			values[i] = elems[i].second;
+		}
+		return (Size)elems.size();
+	}
+	void ImportColumns(const Key *keys, const Value *values, Size count) {
+		for (Size i = 0; i < count; i++)
+			dict[keys[i]] = values[i];
+	}
 	void Reserve(Size arraySizeLB, Size hashSizeLB, bool alwaysCleanHash = false) {
 #ifndef AWH_NO_CPP11
 		dict.rehash(size_t(arraySizeLB + hashSizeLB));
@@ -109,6 +185,28 @@ public:
 			if (action(Key(it->first), it->second))
 				return;
 	}
+	template<class Action> void ForEachSorted(Action &action) const {
+		std::vector<std::pair<Key, Value*> > elems;
+		for (Iter it = const_cast<Map&>(dict).begin(); it != const_cast<Map&>(dict).end(); it++)
+			elems.push_back(std::make_pair(Key(it->first), &it->second));
+		std::sort(elems.begin(), elems.end());
+		for (size_t i = 0; i < elems.size(); i++)
+			if (action(elems[i].first, *elems[i].second))
+				return;
+	}
+
+	template<class Mapping> void Compact(Mapping &oldToNew) {
+		std::vector<Key> keys;
+		for (Iter it = dict.begin(); it != dict.end(); it++)
+			keys.push_back(it->first);
+		std::sort(keys.begin(), keys.end());
+		Map res;
+		for (size_t i = 0; i < keys.size(); i++) {
+			res.insert(std::make_pair(Key(i), AWH_MOVE(dict[keys[i]])));
+			oldToNew.Set(keys[i], Key(i));
+		}
+		dict.swap(res);
+	}
 
 #if defined(AWH_TESTING) && !defined(AWH_NO_CPP11)
 	//note: used only for testing purposes
@@ -10,6 +10,9 @@
 #include "StdMapWrapper.h"
 #include <memory>
 #include <string>
+#include <vector>
+#include <tuple>
+#include <algorithm>
 
 using namespace Awh;
 
@@ -109,17 +112,23 @@ template<class Value> struct ValueTestingUtils<Value*> : public BaseValueTesting
 
 //Testing wrapper around both ArrayHash and StdMapWrapper.
 //It checks that all the outputs of all method calls are the same.
+//Tested container can be replaced by any container with the same interface.
 //Used only for testing purposes
-template<class TKey, class TValue, class TKeyTraits = DefaultKeyTraits<TKey>, class TValueTraits = DefaultValueTraits<TValue>>
+template<
+	class TKey, class TValue, class TKeyTraits = DefaultKeyTraits<TKey>, class TValueTraits = DefaultValueTraits<TValue>,
+	class TTested = ArrayWithHash<TKey, TValue, TKeyTraits, TValueTraits>
+>
 class TestContainer {
 public:
 	typedef TKey Key;
 	typedef TValue Value;
 	typedef TKeyTraits KeyTraits;
 	typedef TValueTraits ValueTraits;
+	//false if tested container supports only basic interface (e.g. SmallArrayWithHash)
+	static const bool FULL_INTERFACE = std::is_same<TTested, ArrayWithHash<TKey, TValue, TKeyTraits, TValueTraits>>::value;
 
 private:
-	typedef ArrayWithHash<Key, Value, KeyTraits, ValueTraits> TArrayWithHash;
+	typedef TTested TArrayWithHash;
 	typedef StdMapWrapper<Key, Value, KeyTraits, ValueTraits> TStdMapWrapper;
 	typedef typename TStdMapWrapper::Ptr TPtr;
 	typedef typename KeyTraits::Size Size;
@@ -214,6 +223,132 @@ public:
 		check.Reserve(arraySizeLB, hashSizeLB, alwaysCleanHash);
 		obj.AssertCorrectness(assertLevel);
 	}
+	void GetPtrBatch(const Key *keys, Size count) const {
+		if (printCommands) std::cout << "GetPtrBatch " << count << std::endl;
+		std::vector<Value*> a(count + 1);
+		std::vector<TPtr> b(count + 1);
+		obj.GetPtrBatch(keys, count, &a[0]);
+		check.GetPtrBatch(keys, count, &b[0]);
+		for (Size i = 0; i < count; i++) {
+			AWH_ASSERT_ALWAYS(Same(a[i], b[i]));
+			AWH_ASSERT_ALWAYS(a[i] == obj.GetPtr(keys[i]));
+		}
+	}
+	void UniteWith(const TestContainer &other) {
+		if (printCommands) std::cout << "UniteWith " << other.GetSize() << std::endl;
+		obj.UniteWith(other.obj);
+		check.UniteWith(other.check);
+		obj.AssertCorrectness(assertLevel);
+		CalcCheckSum();
+	}
+	void IntersectWith(const TestContainer &other) {
+		if (printCommands) std::cout << "IntersectWith " << other.GetSize() << std::endl;
+		obj.IntersectWith(other.obj);
+		check.IntersectWith(other.check);
+		obj.AssertCorrectness(assertLevel);
+		CalcCheckSum();
+	}
+	void Subtract(const TestContainer &other) {
+		if (printCommands) std::cout << "Subtract " << other.GetSize() << std::endl;
+		obj.Subtract(other.obj);
+		check.Subtract(other.check);
+		obj.AssertCorrectness(assertLevel);
+		CalcCheckSum();
+	}
+	Size Length() {
+		if (printCommands) std::cout << "Length" << std::endl;
+		Size a = obj.Length();
+		Size b = check.Length();
+		AWH_ASSERT_ALWAYS(a == b);
+		return a;
+	}
+	Key PushBack(Value value) {
+		if (printCommands) std::cout << "PushBack " << TestUtils::Content(value) << std::endl;
+		Key a = obj.PushBack(TestUtils::Clone(value));
+		Key b = check.PushBack(TestUtils::Clone(value));
+		AWH_ASSERT_ALWAYS(a == b);
+		obj.AssertCorrectness(assertLevel);
+		return a;
+	}
+	void Compact() {
+		if (printCommands) std::cout << "Compact" << std::endl;
+		ArrayWithHash<Key, Key> a;
+		StdMapWrapper<Key, Key> b;
+		obj.Compact(a);
+		check.Compact(b);
+		AWH_ASSERT_ALWAYS(a.GetSize() == b.GetSize() && a.GetSize() == obj.GetSize());
+		auto Compare = [&a](Key key, Key &newKey) -> bool {
+			AWH_ASSERT_ALWAYS(a.Get(key) == newKey);
+			return false;
+		};
+		b.ForEach(Compare);
+		//keys must be dense now
+		AWH_ASSERT_ALWAYS(obj.Length() == obj.GetSize());
+		obj.AssertCorrectness(assertLevel);
+		CalcCheckSum();
+	}
+	bool Equals(const TestContainer &other) const {
+		if (printCommands) std::cout << "Equals " << other.GetSize() << std::endl;
+		bool a = obj.Equals(other.obj);
+		bool b = check.Equals(other.check);
+		AWH_ASSERT_ALWAYS(a == b);
+		return a;
+	}
+	void Diff(const TestContainer &newer) const {
+		if (printCommands) std::cout << "Diff " << newer.GetSize() << std::endl;
+		//each reported change is stored as (kind, key, checksum of values)
+		typedef std::tuple<int, Key, int64_t> Event;
+		std::vector<Event> events;
+		auto onAdded = [&events](Key key, Value &newValue) {
+			events.push_back(Event(0, key, TestUtils::CheckSum(newValue)));
+		};
+		auto onRemoved = [&events](Key key, Value &oldValue) {
+			events.push_back(Event(1, key, TestUtils::CheckSum(oldValue)));
+		};
+		auto onChanged = [&events](Key key, Value &oldValue, Value &newValue) {
+			events.push_back(Event(2, key, TestUtils::CheckSum(oldValue) * 3 + TestUtils::CheckSum(newValue)));
+		};
+		obj.Diff(newer.obj, onAdded, onRemoved, onChanged);
+		std::vector<Event> a;
+		a.swap(events);
+		check.Diff(newer.check, onAdded, onRemoved, onChanged);
+		std::vector<Event> b;
+		b.swap(events);
+		std::sort(a.begin(), a.end());
+		std::sort(b.begin(), b.end());
+		AWH_ASSERT_ALWAYS(a == b);
+	}
+	Size ExportColumns(bool sorted) const {
+		if (printCommands) std::cout << "ExportColumns " << sorted << std::endl;
+		Size size = check.GetSize();
+		std::vector<Key> aKeys(size + 1), bKeys(size + 1);
+		std::vector<Value> aValues(size + 1), bValues(size + 1);
+		Size a = obj.ExportColumns(&aKeys[0], &aValues[0], sorted);
+		Size b = check.ExportColumns(&bKeys[0], &bValues[0], sorted);
+		AWH_ASSERT_ALWAYS(a == size && b == size);
+		//element order: as written if sorted, by key otherwise
+		std::vector<std::pair<Key, Size>> aOrder, bOrder;
+		for (Size i = 0; i < size; i++) {
+			aOrder.push_back(std::make_pair(aKeys[i], i));
+			bOrder.push_back(std::make_pair(bKeys[i], i));
+		}
+		if (!sorted) {
+			std::sort(aOrder.begin(), aOrder.end());
+			std::sort(bOrder.begin(), bOrder.end());
+		}
+		for (Size i = 0; i < size; i++) {
+			AWH_ASSERT_ALWAYS(aOrder[i].first == bOrder[i].first);
+			AWH_ASSERT_ALWAYS(Same(aValues[aOrder[i].second], bValues[bOrder[i].second]));
+		}
+		return a;
+	}
+	void ImportColumns(const Key *keys, const Value *values, Size count) {
+		if (printCommands) std::cout << "ImportColumns " << count << std::endl;
+		obj.ImportColumns(keys, values, count);
+		check.ImportColumns(keys, values, count);
+		obj.AssertCorrectness(assertLevel);
+		CalcCheckSum();
+	}
 	void Swap(TestContainer &other) {
 		if (printCommands) std::cout << "Swap" << std::endl;
 		obj.Swap(other.obj);
@@ -221,12 +356,32 @@ public:
 		obj.AssertCorrectness(assertLevel);
 		other.obj.AssertCorrectness(assertLevel);
 	}
+	void CloneTo(TestContainer &target) const {
+		if (printCommands) std::cout << "CloneTo" << std::endl;
+		obj.CloneTo(target.obj);
+		check.CloneTo(target.check);
+		obj.AssertCorrectness(assertLevel);
+		target.obj.AssertCorrectness(assertLevel);
+	}
 	void Clear() {
 		if (printCommands) std::cout << "Clear" << std::endl;
 		obj.Clear();
 		check.Clear();
 		obj.AssertCorrectness(assertLevel);
 	}
+	void ForEachSorted(Size stopAfter) const {
+		if (printCommands) std::cout << "ForEachSorted " << stopAfter << std::endl;
+		std::vector<std::pair<Key, int64_t>> elems;
+		auto Add = [&elems, stopAfter](Key key, Value &value) -> bool {
+			elems.push_back(std::make_pair(key, int64_t(TestUtils::CheckSum(value))));
+			return elems.size() >= stopAfter;
+		};
+		obj.ForEachSorted(Add);
+		std::vector<std::pair<Key, int64_t>> a;
+		a.swap(elems);
+		check.ForEachSorted(Add);
+		AWH_ASSERT_ALWAYS(a == elems);
+	}
 	int64_t CalcCheckSum() const {
 		int64_t sum;
 		auto Add = [&sum](Key key, Value &value) -> bool {
@@ -245,6 +400,10 @@ public:
 
 	//for testing only
 	template<class Rnd> Value *SomePtr(Rnd &rnd) const {
-		return obj.GetPtr(check.SomeKey(rnd));
+		Value *a = obj.SampleRandom(rnd);
+		AWH_ASSERT_ALWAYS(a);
+		TPtr b = check.GetPtr(obj.KeyOf(a));
+		AWH_ASSERT_ALWAYS(Same(a, b));
+		return a;
 	}
 };
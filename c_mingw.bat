@@ -1,3 +1,9 @@
 g++ TestsMain.cpp CorrectnessTests.cpp PerformanceTests.cpp timer.c -O2 -std=c++11 -D NDEBUG -D AWH_TESTING -D AWH_CONTROL_INLINING -o TestsMain_mingw.exe
 if errorlevel 1 exit
+rem tests of StaticArrayWithHash are compiled only in C++14 mode
+g++ TestsMain.cpp CorrectnessTests.cpp PerformanceTests.cpp timer.c -O2 -std=c++14 -D NDEBUG -D AWH_TESTING -D AWH_CONTROL_INLINING -o TestsMain_mingw_cpp14.exe
+if errorlevel 1 exit
+rem tests of coroutine-based lookups are compiled only in C++20 mode
+g++ TestsMain.cpp CorrectnessTests.cpp PerformanceTests.cpp timer.c -O2 -std=c++20 -D NDEBUG -D AWH_TESTING -D AWH_CONTROL_INLINING -o TestsMain_mingw_cpp20.exe
+if errorlevel 1 exit
 g++ PerformanceTests.cpp -S -O2 -std=c++11 -D NDEBUG -D AWH_TESTING -D AWH_CONTROL_INLINING